@@ -58,4 +58,20 @@ void buildHierarchy(const MDagPath& path, std::vector<std::string>& result)
             result.push_back(name.asChar());
         }
     }
-}
\ No newline at end of file
+}
+
+void buildHierarchy(const MDagPath& path, std::vector<MDagPath>& result)
+{
+
+    MDagPath meshPath;
+
+    MItDag dagIter;
+    for (dagIter.reset(path, MItDag::kDepthFirst); !dagIter.isDone(); dagIter.next()) {
+        MObject obj = dagIter.currentItem();
+
+        if (obj.apiType() == MFn::kMesh) {
+            dagIter.getPath(meshPath);
+            result.push_back(meshPath);
+        }
+    }
+}
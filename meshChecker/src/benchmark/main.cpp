@@ -0,0 +1,262 @@
+//
+//  main.cpp
+//  Benchmark of the geometry kernels, without Maya. Build with
+//  g++ -std=c++11 -O2 -ffp-contract=off main.cpp ../geometryKernel.cpp ../meshTopology.cpp
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../geometryKernel.hpp"
+#include "../meshTopology.hpp"
+
+struct Mesh {
+    std::vector<float> points;
+    std::vector<unsigned int> faceOffsets;
+    std::vector<int> faceVertices;
+    std::vector<int> edgeVertices;
+};
+
+// Wavy grid of quads, where one quad in ten is split into two triangles and
+// one vertex in a hundred is moved onto its neighbour, which makes zero
+// length edges and zero area faces
+static void createGrid(int quadsPerSide, unsigned int seed, Mesh& mesh)
+{
+    int pointsPerSide = quadsPerSide + 1;
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<int> chance(0, 99);
+
+    mesh.points.clear();
+    for (int y = 0; y < pointsPerSide; y++) {
+        for (int x = 0; x < pointsPerSide; x++) {
+            float u = static_cast<float>(x) / static_cast<float>(quadsPerSide);
+            float v = static_cast<float>(y) / static_cast<float>(quadsPerSide);
+            if (x > 0 && chance(engine) == 0) {
+                u = static_cast<float>(x - 1) / static_cast<float>(quadsPerSide);
+            }
+            mesh.points.push_back(u * 100.0F);
+            mesh.points.push_back(v * 100.0F);
+            mesh.points.push_back(std::sin(u * 20.0F) * std::cos(v * 20.0F));
+        }
+    }
+
+    auto getVertex = [pointsPerSide](int x, int y) { return y * pointsPerSide + x; };
+    mesh.faceOffsets.assign(1, 0);
+    mesh.faceVertices.clear();
+    mesh.edgeVertices.clear();
+    for (int y = 0; y < quadsPerSide; y++) {
+        for (int x = 0; x < quadsPerSide; x++) {
+            int corners[4] = { getVertex(x, y), getVertex(x + 1, y), getVertex(x + 1, y + 1), getVertex(x, y + 1) };
+            if (chance(engine) < 10) {
+                mesh.faceVertices.insert(mesh.faceVertices.end(), { corners[0], corners[1], corners[2] });
+                mesh.faceOffsets.push_back(static_cast<unsigned int>(mesh.faceVertices.size()));
+                mesh.faceVertices.insert(mesh.faceVertices.end(), { corners[0], corners[2], corners[3] });
+                mesh.edgeVertices.insert(mesh.edgeVertices.end(), { corners[0], corners[2] });
+            } else {
+                mesh.faceVertices.insert(mesh.faceVertices.end(), corners, corners + 4);
+            }
+            mesh.faceOffsets.push_back(static_cast<unsigned int>(mesh.faceVertices.size()));
+            mesh.edgeVertices.insert(mesh.edgeVertices.end(), { corners[0], corners[1], corners[0], corners[3] });
+        }
+    }
+}
+
+// Bow ties and quads folded onto their first triangle, 8 of each so that
+// they fill whole vector blocks. Their triangles have an area of 0.5 each,
+// none of them is a zero area face
+static void createBowTies(Mesh& mesh)
+{
+    const float corners[2][12] = {
+        { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 0, 0 }
+    };
+
+    mesh.points.clear();
+    mesh.faceOffsets.assign(1, 0);
+    mesh.faceVertices.clear();
+    for (int face = 0; face < 16; face++) {
+        const float* faceCorners = corners[face / 8];
+        for (int i = 0; i < 4; i++) {
+            mesh.faceVertices.push_back(static_cast<int>(mesh.points.size() / 3));
+            mesh.points.push_back(faceCorners[i * 3] + static_cast<float>(face) * 2.0F);
+            mesh.points.push_back(faceCorners[i * 3 + 1]);
+            mesh.points.push_back(faceCorners[i * 3 + 2]);
+        }
+        mesh.faceOffsets.push_back(static_cast<unsigned int>(mesh.faceVertices.size()));
+    }
+}
+
+static size_t countBits(const std::vector<uint32_t>& masks)
+{
+    size_t count = 0;
+    for (uint32_t mask : masks) {
+        for (; mask != 0; mask &= mask - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Short edges of a grid found chunk by chunk over the edges of findEdges, as
+// checkMesh does, against those found over the whole mesh in its own edge
+// order. The mesh numbers its edges in a shuffled order, as an edited mesh
+// does, and the edges of all chunks are only sorted once they are merged.
+// Sorting each chunk on its own gets the order wrong, which is also counted.
+// Returns the number of edges out of place
+static size_t checkRenumberedEdges(const Mesh& mesh)
+{
+    // Chunk size of checkMesh
+    const size_t chunkSize = 4096;
+
+    size_t numFaces = mesh.faceOffsets.size() - 1;
+    std::vector<int> faceCounts(numFaces);
+    for (size_t i = 0; i < numFaces; i++) {
+        faceCounts[i] = static_cast<int>(mesh.faceOffsets[i + 1] - mesh.faceOffsets[i]);
+    }
+    size_t numVertices = mesh.points.size() / 3;
+    std::vector<int> topologyEdges;
+    findEdges(faceCounts, mesh.faceVertices, numVertices, topologyEdges);
+    size_t numEdges = topologyEdges.size() / 2;
+
+    std::vector<size_t> order(numEdges);
+    for (size_t i = 0; i < numEdges; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    std::vector<int> meshEdges(numEdges * 2);
+    for (size_t i = 0; i < numEdges; i++) {
+        size_t flip = i % 2;
+        meshEdges[i * 2] = topologyEdges[order[i] * 2 + flip];
+        meshEdges[i * 2 + 1] = topologyEdges[order[i] * 2 + 1 - flip];
+    }
+
+    std::vector<int> expected;
+    std::vector<uint32_t> masks(geometryKernel::getMaskSize(numEdges));
+    geometryKernel::findShortEdges(mesh.points.data(), meshEdges.data(), numEdges, 0.000001, masks.data());
+    for (size_t i = 0; i < numEdges; i++) {
+        if (((masks[i / 32] >> (i % 32)) & 1U) != 0) {
+            expected.push_back(static_cast<int>(i));
+        }
+    }
+
+    EdgeTable table;
+    table.build(meshEdges, numVertices);
+    std::vector<int> merged;
+    std::vector<int> chunkSorted;
+    size_t numChunks = 0;
+    for (size_t begin = 0; begin < numEdges; begin += chunkSize, numChunks++) {
+        size_t count = std::min(chunkSize, numEdges - begin);
+        std::vector<uint32_t> chunkMasks(geometryKernel::getMaskSize(count));
+        geometryKernel::findShortEdges(mesh.points.data(), topologyEdges.data() + begin * 2, count, 0.000001, chunkMasks.data());
+        std::vector<int> shortEdges;
+        for (size_t i = 0; i < count; i++) {
+            if (((chunkMasks[i / 32] >> (i % 32)) & 1U) != 0) {
+                size_t e = begin + i;
+                shortEdges.push_back(table.find(topologyEdges[e * 2], topologyEdges[e * 2 + 1]));
+            }
+        }
+        merged.insert(merged.end(), shortEdges.begin(), shortEdges.end());
+        std::sort(shortEdges.begin(), shortEdges.end());
+        chunkSorted.insert(chunkSorted.end(), shortEdges.begin(), shortEdges.end());
+    }
+    std::sort(merged.begin(), merged.end());
+
+    size_t numChunkSortedMismatches = 0;
+    size_t numMismatches = merged.size() != expected.size() ? 1U : 0U;
+    for (size_t i = 0; i < std::min(merged.size(), expected.size()); i++) {
+        numChunkSortedMismatches += chunkSorted[i] != expected[i] ? 1U : 0U;
+        numMismatches += merged[i] != expected[i] ? 1U : 0U;
+    }
+
+    std::cout << "edges,chunks,shortEdges,chunkSortedMismatches,mismatches" << std::endl;
+    std::cout << numEdges << "," << numChunks << "," << expected.size() << ","
+              << numChunkSortedMismatches << "," << numMismatches << std::endl;
+    return numMismatches;
+}
+
+// Faces and edges per second of each instruction set on a 1M quad grid.
+// Masks have to be the same as the scalar ones, and no bow tie may be found.
+// Then checks zero length edges of a renumbered mesh split into chunks
+int main()
+{
+    std::cout << "instructionSet,facesPerSecond,edgesPerSecond,smallFaces,shortEdges,mismatches,bowTies"
+              << std::endl;
+
+    Mesh bowTies;
+    createBowTies(bowTies);
+    size_t numBowTies = bowTies.faceOffsets.size() - 1;
+    std::vector<uint32_t> bowTieMasks(geometryKernel::getMaskSize(numBowTies));
+
+    Mesh mesh;
+    createGrid(1000, 1, mesh);
+    size_t numFaces = mesh.faceOffsets.size() - 1;
+    size_t numEdges = mesh.edgeVertices.size() / 2;
+    std::vector<uint32_t> faceMasks(geometryKernel::getMaskSize(numFaces));
+    std::vector<uint32_t> edgeMasks(geometryKernel::getMaskSize(numEdges));
+    std::vector<uint32_t> scalarFaceMasks;
+    std::vector<uint32_t> scalarEdgeMasks;
+
+    geometryKernel::InstructionSet supported = geometryKernel::getSupportedInstructionSet();
+    const geometryKernel::InstructionSet instructionSets[] = { geometryKernel::SCALAR, supported };
+    for (geometryKernel::InstructionSet instructionSet : instructionSets) {
+        if (instructionSet == geometryKernel::SCALAR && !scalarFaceMasks.empty()) {
+            break;
+        }
+        geometryKernel::setInstructionSet(instructionSet);
+
+        size_t numRuns = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> faceTime(0);
+        while (faceTime.count() < 0.5) {
+            geometryKernel::findSmallFaces(mesh.points.data(), mesh.faceOffsets.data(), mesh.faceVertices.data(),
+                numFaces, 0.000001, faceMasks.data());
+            numRuns++;
+            faceTime = std::chrono::steady_clock::now() - start;
+        }
+        double facesPerSecond = static_cast<double>(numFaces * numRuns) / faceTime.count();
+
+        numRuns = 0;
+        start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> edgeTime(0);
+        while (edgeTime.count() < 0.5) {
+            geometryKernel::findShortEdges(mesh.points.data(), mesh.edgeVertices.data(), numEdges,
+                0.000001, edgeMasks.data());
+            numRuns++;
+            edgeTime = std::chrono::steady_clock::now() - start;
+        }
+        double edgesPerSecond = static_cast<double>(numEdges * numRuns) / edgeTime.count();
+
+        geometryKernel::findSmallFaces(bowTies.points.data(), bowTies.faceOffsets.data(), bowTies.faceVertices.data(),
+            numBowTies, 0.000001, bowTieMasks.data());
+
+        if (scalarFaceMasks.empty()) {
+            scalarFaceMasks = faceMasks;
+            scalarEdgeMasks = edgeMasks;
+        }
+        size_t numMismatches = 0;
+        for (size_t i = 0; i < faceMasks.size(); i++) {
+            numMismatches += faceMasks[i] != scalarFaceMasks[i] ? 1U : 0U;
+        }
+        for (size_t i = 0; i < edgeMasks.size(); i++) {
+            numMismatches += edgeMasks[i] != scalarEdgeMasks[i] ? 1U : 0U;
+        }
+
+        std::cout << geometryKernel::getName(geometryKernel::getInstructionSet()) << ","
+                  << facesPerSecond << ","
+                  << edgesPerSecond << ","
+                  << countBits(faceMasks) << ","
+                  << countBits(edgeMasks) << ","
+                  << numMismatches << ","
+                  << countBits(bowTieMasks) << std::endl;
+    }
+    geometryKernel::setInstructionSet(supported);
+
+    Mesh renumbered;
+    createGrid(100, 2, renumbered);
+    return checkRenumberedEdges(renumbered) == 0 ? 0 : 1;
+}
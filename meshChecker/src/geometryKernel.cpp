@@ -0,0 +1,467 @@
+//
+//  geometryKernel.cpp
+//
+//  This file has to be compiled without floating point contraction
+//  (-ffp-contract=off), otherwise the compiler may fuse multiplications and
+//  additions into FMA instructions in some kernels and not in others, and
+//  values right at a threshold would differ between instruction sets
+//
+
+#include "geometryKernel.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GEOMETRY_KERNEL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GEOMETRY_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+
+typedef void (*FaceKernelFunc)(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t numFaces, float limit, uint32_t* masks);
+
+typedef void (*EdgeKernelFunc)(const float* points, const int* edgeVertices, size_t numEdges,
+    float limit, uint32_t* masks);
+
+void setBit(uint32_t* masks, size_t index)
+{
+    masks[index >> 5] |= 1U << (index & 31);
+}
+
+// Threshold as a float. One so small that it is not a normal float still
+// finds zero values
+float getLimit(double threshold)
+{
+    if (threshold <= 0.0) {
+        return 0.0F;
+    }
+    double limit = std::min(threshold, static_cast<double>(FLT_MAX));
+    return std::max(static_cast<float>(limit), FLT_MIN);
+}
+
+// Edge kernels compare squared lengths, which saves the square roots
+float getSquaredLimit(double threshold)
+{
+    return getLimit(std::min(threshold * threshold, static_cast<double>(FLT_MAX)));
+}
+
+// Each triangle of the fan from the first vertex adds the length of its
+// cross product, twice its area, so the limit is on twice the area. The
+// cross products themselves would cancel out on bow ties and on faces
+// folded onto themselves. Square roots are correctly rounded in every
+// instruction set, so all kernels get the same sums
+void findSmallFacesScalarRange(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t begin, size_t end, float limit, uint32_t* masks)
+{
+    for (size_t i = begin; i < end; i++) {
+        unsigned int first = faceOffsets[i];
+        unsigned int last = faceOffsets[i + 1];
+        float area = 0.0F;
+        if (last - first >= 3) {
+            const float* p0 = points + static_cast<size_t>(faceVertices[first]) * 3;
+            const float* p1 = points + static_cast<size_t>(faceVertices[first + 1]) * 3;
+            float ax = p1[0] - p0[0];
+            float ay = p1[1] - p0[1];
+            float az = p1[2] - p0[2];
+            for (unsigned int j = first + 2; j < last; j++) {
+                const float* p2 = points + static_cast<size_t>(faceVertices[j]) * 3;
+                float bx = p2[0] - p0[0];
+                float by = p2[1] - p0[1];
+                float bz = p2[2] - p0[2];
+                float cx = ay * bz - az * by;
+                float cy = az * bx - ax * bz;
+                float cz = ax * by - ay * bx;
+                area += std::sqrt(cx * cx + cy * cy + cz * cz);
+                ax = bx;
+                ay = by;
+                az = bz;
+            }
+        }
+        if (area < limit) {
+            setBit(masks, i);
+        }
+    }
+}
+
+void findSmallFacesScalar(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t numFaces, float limit, uint32_t* masks)
+{
+    findSmallFacesScalarRange(points, faceOffsets, faceVertices, 0, numFaces, limit, masks);
+}
+
+void findShortEdgesScalarRange(const float* points, const int* edgeVertices,
+    size_t begin, size_t end, float limit, uint32_t* masks)
+{
+    for (size_t i = begin; i < end; i++) {
+        const float* p0 = points + static_cast<size_t>(edgeVertices[i * 2]) * 3;
+        const float* p1 = points + static_cast<size_t>(edgeVertices[i * 2 + 1]) * 3;
+        float dx = p1[0] - p0[0];
+        float dy = p1[1] - p0[1];
+        float dz = p1[2] - p0[2];
+        if (dx * dx + dy * dy + dz * dz < limit) {
+            setBit(masks, i);
+        }
+    }
+}
+
+void findShortEdgesScalar(const float* points, const int* edgeVertices, size_t numEdges,
+    float limit, uint32_t* masks)
+{
+    findShortEdgesScalarRange(points, edgeVertices, 0, numEdges, limit, masks);
+}
+
+#ifdef GEOMETRY_KERNEL_X86
+
+// Each lane follows the fan of one face, for as many steps as the face of
+// the block with the most vertices needs. Lanes of faces already done load
+// their first vertex again, which adds a zero area triangle. Blocks never
+// straddle two mask words as 8 divides 32
+KERNEL_TARGET("avx2")
+void findSmallFacesAVX2(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t numFaces, float limit, uint32_t* masks)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256 vlimit = _mm256_set1_ps(limit);
+
+    size_t i = 0;
+    for (; i + 8 <= numFaces; i += 8) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(faceOffsets + i));
+        __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(faceOffsets + i + 1));
+        __m256i count = _mm256_sub_epi32(last, first);
+
+        __m256i maxCount = _mm256_max_epi32(count, _mm256_permute2x128_si256(count, count, 1));
+        maxCount = _mm256_max_epi32(maxCount, _mm256_shuffle_epi32(maxCount, 0x4E));
+        maxCount = _mm256_max_epi32(maxCount, _mm256_shuffle_epi32(maxCount, 0xB1));
+        int steps = _mm256_cvtsi256_si32(maxCount);
+
+        // Faces with less than 3 vertices have no triangle and keep zero areas
+        __m256i hasTriangle = _mm256_cmpgt_epi32(count, _mm256_set1_epi32(2));
+        __m256i vertex0 = _mm256_mask_i32gather_epi32(zero, faceVertices, first, hasTriangle, 4);
+        __m256i offset0 = _mm256_mullo_epi32(vertex0, three);
+        __m256 p0x = _mm256_i32gather_ps(points, offset0, 4);
+        __m256 p0y = _mm256_i32gather_ps(points + 1, offset0, 4);
+        __m256 p0z = _mm256_i32gather_ps(points + 2, offset0, 4);
+
+        __m256i vertex1 = _mm256_mask_i32gather_epi32(vertex0, faceVertices, _mm256_add_epi32(first, one), hasTriangle, 4);
+        __m256i offset1 = _mm256_mullo_epi32(vertex1, three);
+        __m256 ax = _mm256_sub_ps(_mm256_i32gather_ps(points, offset1, 4), p0x);
+        __m256 ay = _mm256_sub_ps(_mm256_i32gather_ps(points + 1, offset1, 4), p0y);
+        __m256 az = _mm256_sub_ps(_mm256_i32gather_ps(points + 2, offset1, 4), p0z);
+
+        __m256 area = _mm256_setzero_ps();
+        for (int j = 2; j < steps; j++) {
+            __m256i corner = _mm256_set1_epi32(j);
+            __m256i isActive = _mm256_cmpgt_epi32(count, corner);
+            __m256i vertex2 = _mm256_mask_i32gather_epi32(vertex0, faceVertices, _mm256_add_epi32(first, corner), isActive, 4);
+            __m256i offset2 = _mm256_mullo_epi32(vertex2, three);
+            __m256 bx = _mm256_sub_ps(_mm256_i32gather_ps(points, offset2, 4), p0x);
+            __m256 by = _mm256_sub_ps(_mm256_i32gather_ps(points + 1, offset2, 4), p0y);
+            __m256 bz = _mm256_sub_ps(_mm256_i32gather_ps(points + 2, offset2, 4), p0z);
+            __m256 cx = _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by));
+            __m256 cy = _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz));
+            __m256 cz = _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx));
+            __m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+            area = _mm256_add_ps(area, _mm256_sqrt_ps(squared));
+            ax = bx;
+            ay = by;
+            az = bz;
+        }
+
+        auto smallFaces = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(area, vlimit, _CMP_LT_OQ)));
+        masks[i >> 5] |= smallFaces << (i & 31);
+    }
+    findSmallFacesScalarRange(points, faceOffsets, faceVertices, i, numFaces, limit, masks);
+}
+
+KERNEL_TARGET("avx2")
+void findShortEdgesAVX2(const float* points, const int* edgeVertices, size_t numEdges,
+    float limit, uint32_t* masks)
+{
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i evenFirst = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256 vlimit = _mm256_set1_ps(limit);
+
+    size_t i = 0;
+    for (; i + 8 <= numEdges; i += 8) {
+        // Vertex pairs of 8 edges split into the first and second vertices
+        __m256i pairs0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(edgeVertices + i * 2));
+        __m256i pairs1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(edgeVertices + i * 2 + 8));
+        pairs0 = _mm256_permutevar8x32_epi32(pairs0, evenFirst);
+        pairs1 = _mm256_permutevar8x32_epi32(pairs1, evenFirst);
+        __m256i offset0 = _mm256_mullo_epi32(_mm256_permute2x128_si256(pairs0, pairs1, 0x20), three);
+        __m256i offset1 = _mm256_mullo_epi32(_mm256_permute2x128_si256(pairs0, pairs1, 0x31), three);
+
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(points, offset1, 4), _mm256_i32gather_ps(points, offset0, 4));
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(points + 1, offset1, 4), _mm256_i32gather_ps(points + 1, offset0, 4));
+        __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(points + 2, offset1, 4), _mm256_i32gather_ps(points + 2, offset0, 4));
+
+        __m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        auto shortEdges = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(squared, vlimit, _CMP_LT_OQ)));
+        masks[i >> 5] |= shortEdges << (i & 31);
+    }
+    findShortEdgesScalarRange(points, edgeVertices, i, numEdges, limit, masks);
+}
+
+#if defined(_MSC_VER)
+uint64_t getEnabledXStates()
+{
+    return _xgetbv(0);
+}
+#endif
+
+geometryKernel::InstructionSet detectInstructionSet()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+    bool hasAVX = (info[2] & (1 << 28)) != 0;
+    bool hasAVX2 = false;
+    if (maxLeaf >= 7 && hasOSXSave && hasAVX) {
+        // The OS has to save the vector registers on context switches
+        uint64_t xStates = getEnabledXStates();
+        __cpuidex(info, 7, 0);
+        hasAVX2 = (xStates & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool hasAVX2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return hasAVX2 ? geometryKernel::AVX2 : geometryKernel::SCALAR;
+}
+
+#elif defined(GEOMETRY_KERNEL_NEON)
+
+// NEON has no gathers, points are loaded lane by lane. Lanes of faces
+// already done load their first vertex again, as in the AVX2 kernel
+
+// Points of 4 vertices, one vector per axis
+float32x4x3_t loadPoints(const float* points, const int* vertices)
+{
+    float32x4x3_t p = { { vdupq_n_f32(0.0F), vdupq_n_f32(0.0F), vdupq_n_f32(0.0F) } };
+    p = vld3q_lane_f32(points + static_cast<size_t>(vertices[0]) * 3, p, 0);
+    p = vld3q_lane_f32(points + static_cast<size_t>(vertices[1]) * 3, p, 1);
+    p = vld3q_lane_f32(points + static_cast<size_t>(vertices[2]) * 3, p, 2);
+    p = vld3q_lane_f32(points + static_cast<size_t>(vertices[3]) * 3, p, 3);
+    return p;
+}
+
+uint32_t getLaneBits(uint32x4_t lanes)
+{
+    static const uint32_t bits[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(lanes, vld1q_u32(bits)));
+}
+
+void findSmallFacesNEON(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t numFaces, float limit, uint32_t* masks)
+{
+    const float32x4_t vlimit = vdupq_n_f32(limit);
+
+    size_t i = 0;
+    for (; i + 4 <= numFaces; i += 4) {
+        unsigned int first[4];
+        unsigned int count[4];
+        unsigned int steps = 0;
+        int vertex0[4];
+        int vertices[4];
+        for (size_t lane = 0; lane < 4; lane++) {
+            first[lane] = faceOffsets[i + lane];
+            count[lane] = faceOffsets[i + lane + 1] - first[lane];
+            steps = std::max(steps, count[lane]);
+            // Faces with less than 3 vertices have no triangle and keep zero areas
+            vertex0[lane] = count[lane] >= 3 ? faceVertices[first[lane]] : 0;
+        }
+        float32x4x3_t p0 = loadPoints(points, vertex0);
+
+        for (size_t lane = 0; lane < 4; lane++) {
+            vertices[lane] = count[lane] >= 3 ? faceVertices[first[lane] + 1] : vertex0[lane];
+        }
+        float32x4x3_t p1 = loadPoints(points, vertices);
+        float32x4_t ax = vsubq_f32(p1.val[0], p0.val[0]);
+        float32x4_t ay = vsubq_f32(p1.val[1], p0.val[1]);
+        float32x4_t az = vsubq_f32(p1.val[2], p0.val[2]);
+
+        float32x4_t area = vdupq_n_f32(0.0F);
+        for (unsigned int j = 2; j < steps; j++) {
+            for (size_t lane = 0; lane < 4; lane++) {
+                vertices[lane] = j < count[lane] ? faceVertices[first[lane] + j] : vertex0[lane];
+            }
+            float32x4x3_t p2 = loadPoints(points, vertices);
+            float32x4_t bx = vsubq_f32(p2.val[0], p0.val[0]);
+            float32x4_t by = vsubq_f32(p2.val[1], p0.val[1]);
+            float32x4_t bz = vsubq_f32(p2.val[2], p0.val[2]);
+            float32x4_t cx = vsubq_f32(vmulq_f32(ay, bz), vmulq_f32(az, by));
+            float32x4_t cy = vsubq_f32(vmulq_f32(az, bx), vmulq_f32(ax, bz));
+            float32x4_t cz = vsubq_f32(vmulq_f32(ax, by), vmulq_f32(ay, bx));
+            float32x4_t squared = vaddq_f32(vaddq_f32(vmulq_f32(cx, cx), vmulq_f32(cy, cy)), vmulq_f32(cz, cz));
+            area = vaddq_f32(area, vsqrtq_f32(squared));
+            ax = bx;
+            ay = by;
+            az = bz;
+        }
+
+        masks[i >> 5] |= getLaneBits(vcltq_f32(area, vlimit)) << (i & 31);
+    }
+    findSmallFacesScalarRange(points, faceOffsets, faceVertices, i, numFaces, limit, masks);
+}
+
+void findShortEdgesNEON(const float* points, const int* edgeVertices, size_t numEdges,
+    float limit, uint32_t* masks)
+{
+    const float32x4_t vlimit = vdupq_n_f32(limit);
+
+    size_t i = 0;
+    for (; i + 4 <= numEdges; i += 4) {
+        // Vertex pairs of 4 edges split into the first and second vertices
+        int32x4x2_t pairs = vld2q_s32(edgeVertices + i * 2);
+        int vertices0[4];
+        int vertices1[4];
+        vst1q_s32(vertices0, pairs.val[0]);
+        vst1q_s32(vertices1, pairs.val[1]);
+        float32x4x3_t p0 = loadPoints(points, vertices0);
+        float32x4x3_t p1 = loadPoints(points, vertices1);
+
+        float32x4_t dx = vsubq_f32(p1.val[0], p0.val[0]);
+        float32x4_t dy = vsubq_f32(p1.val[1], p0.val[1]);
+        float32x4_t dz = vsubq_f32(p1.val[2], p0.val[2]);
+
+        float32x4_t squared = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+        masks[i >> 5] |= getLaneBits(vcltq_f32(squared, vlimit)) << (i & 31);
+    }
+    findShortEdgesScalarRange(points, edgeVertices, i, numEdges, limit, masks);
+}
+
+// NEON is part of every 64 bit ARM CPU
+geometryKernel::InstructionSet detectInstructionSet()
+{
+    return geometryKernel::NEON;
+}
+
+#else
+
+geometryKernel::InstructionSet detectInstructionSet()
+{
+    return geometryKernel::SCALAR;
+}
+
+#endif
+
+FaceKernelFunc getFaceKernel(geometryKernel::InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+#if defined(GEOMETRY_KERNEL_X86)
+    case geometryKernel::AVX2:
+        return findSmallFacesAVX2;
+#elif defined(GEOMETRY_KERNEL_NEON)
+    case geometryKernel::NEON:
+        return findSmallFacesNEON;
+#endif
+    default:
+        return findSmallFacesScalar;
+    }
+}
+
+EdgeKernelFunc getEdgeKernel(geometryKernel::InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+#if defined(GEOMETRY_KERNEL_X86)
+    case geometryKernel::AVX2:
+        return findShortEdgesAVX2;
+#elif defined(GEOMETRY_KERNEL_NEON)
+    case geometryKernel::NEON:
+        return findShortEdgesNEON;
+#endif
+    default:
+        return findShortEdgesScalar;
+    }
+}
+
+geometryKernel::InstructionSet& currentInstructionSet()
+{
+    static geometryKernel::InstructionSet instructionSet = geometryKernel::getSupportedInstructionSet();
+    return instructionSet;
+}
+
+FaceKernelFunc& currentFaceKernel()
+{
+    static FaceKernelFunc kernel = getFaceKernel(currentInstructionSet());
+    return kernel;
+}
+
+EdgeKernelFunc& currentEdgeKernel()
+{
+    static EdgeKernelFunc kernel = getEdgeKernel(currentInstructionSet());
+    return kernel;
+}
+
+} // namespace
+
+namespace geometryKernel {
+
+InstructionSet getSupportedInstructionSet()
+{
+    static const InstructionSet supported = detectInstructionSet();
+    return supported;
+}
+
+InstructionSet getInstructionSet()
+{
+    return currentInstructionSet();
+}
+
+InstructionSet setInstructionSet(InstructionSet instructionSet)
+{
+    // Scalar or the supported set, which is the only other one on a CPU
+    if (instructionSet == SCALAR || instructionSet == getSupportedInstructionSet()) {
+        currentInstructionSet() = instructionSet;
+        currentFaceKernel() = getFaceKernel(instructionSet);
+        currentEdgeKernel() = getEdgeKernel(instructionSet);
+    }
+    return currentInstructionSet();
+}
+
+const char* getName(InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+    case AVX2:
+        return "AVX2";
+    case NEON:
+        return "NEON";
+    default:
+        return "scalar";
+    }
+}
+
+void findSmallFaces(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t numFaces, double maxArea, uint32_t* masks)
+{
+    std::fill(masks, masks + getMaskSize(numFaces), 0U);
+    currentFaceKernel()(points, faceOffsets, faceVertices, numFaces, getLimit(maxArea * 2.0), masks);
+}
+
+void findShortEdges(const float* points, const int* edgeVertices, size_t numEdges,
+    double minLength, uint32_t* masks)
+{
+    std::fill(masks, masks + getMaskSize(numEdges), 0U);
+    currentEdgeKernel()(points, edgeVertices, numEdges, getSquaredLimit(minLength), masks);
+}
+}
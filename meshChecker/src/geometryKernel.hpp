@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Face areas and edge lengths of a whole mesh at once, straight from the bulk
+// point and index arrays. 8 faces or edges are handled per instruction with
+// AVX2 and 4 with NEON, depending on what the CPU supports. Results are
+// exactly the same whatever the instruction set is
+namespace geometryKernel {
+
+enum InstructionSet {
+    SCALAR,
+    AVX2,
+    NEON
+};
+
+// Best instruction set supported by the CPU and the OS
+InstructionSet getSupportedInstructionSet();
+
+// Instruction set used by the kernels, the supported one by default
+InstructionSet getInstructionSet();
+
+// Force an instruction set, mainly for benchmarking. Sets which are not
+// supported are ignored. Not thread safe, call it before any check starts.
+// Returns the instruction set in use afterwards
+InstructionSet setInstructionSet(InstructionSet instructionSet);
+
+const char* getName(InstructionSet instructionSet);
+
+// Number of 32 bit mask words needed for count faces or edges
+inline size_t getMaskSize(size_t count)
+{
+    return (count + 31) / 32;
+}
+
+// Bit i of the masks is set if the area of face i is below maxArea. points
+// holds x, y, z of each vertex as MFnMesh::getRawPoints returns them. Face i
+// has vertices faceVertices[faceOffsets[i]] to
+// faceVertices[faceOffsets[i + 1] - 1], so faceOffsets holds numFaces + 1
+// entries. The area of a face is the sum of the areas of the fan of
+// triangles from its first vertex, so faces that aren't flat or cross
+// themselves aren't taken for zero area ones
+void findSmallFaces(const float* points, const unsigned int* faceOffsets, const int* faceVertices,
+    size_t numFaces, double maxArea, uint32_t* masks);
+
+// Bit i of the masks is set if edge i, from vertex edgeVertices[i * 2] to
+// edgeVertices[i * 2 + 1], is shorter than minLength
+void findShortEdges(const float* points, const int* edgeVertices, size_t numEdges,
+    double minLength, uint32_t* masks);
+}
@@ -1,4 +1,6 @@
 #include "meshChecker.hpp"
+#include "geometryKernel.hpp"
+#include "topologyCache.hpp"
 #include "../../include/ThreadPool.hpp"
 #include "../../include/utils.hpp"
 #include "maya/MApiNamespace.h"
@@ -14,11 +16,9 @@
 #include <maya/MFnDagNode.h>
 #include <maya/MFnMesh.h>
 #include <maya/MFnPlugin.h>
+#include <maya/MIntArray.h>
 #include <maya/MGlobal.h>
 #include <maya/MItDag.h>
-#include <maya/MItMeshEdge.h>
-#include <maya/MItMeshPolygon.h>
-#include <maya/MItMeshVertex.h>
 #include <maya/MPlug.h>
 #include <maya/MSelectionList.h>
 #include <maya/MString.h>
@@ -30,6 +30,8 @@
 #include <string>
 #include <thread>
 #include <algorithm>
+#include <iterator>
+#include <memory>
 
 static const char* const pluginCommandName = "checkMesh";
 static const char* const pluginVersion = "2.3.0";
@@ -37,487 +39,488 @@ static const char* const pluginAuthor = "Michi Inoue";
 
 namespace {
 
-std::vector<std::string> findTriangles(std::vector<std::string>* paths)
-{
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
+const size_t numCheckTypes = static_cast<size_t>(MeshCheckType::TEST);
 
-    std::vector<std::string> result;
-    std::string errorPath;
+// Checks requested by one command call, indexed by MeshCheckType
+struct CheckOptions {
+    bool isRequested[numCheckTypes];
+    double maxFaceArea;
+    double minEdgeLength;
 
-    unsigned int length = list.length();
+    bool has(MeshCheckType type) const
+    {
+        return isRequested[static_cast<size_t>(type)];
+    }
+};
 
-    MDagPath dagPath;
+// Result paths of every check, indexed by MeshCheckType
+using CheckResults = std::vector<std::vector<std::string>>;
 
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        MFnMesh mesh(dagPath);
-        int numPoly = mesh.numPolygons();
+void addComponent(const MDagPath& dagPath, ResultType type, int index, std::vector<std::string>& result)
+{
+    result.emplace_back();
+    createResultString(dagPath, type, index, result.back());
+}
 
-        for (int j = 0; j < numPoly; j++) {
-            if (mesh.polygonVertexCount(j) == 3) {
-                createResultString(dagPath, ResultType::Face, j, errorPath);
-                result.push_back(errorPath);
+// Components whose bit is set in the masks of a kernel, bit 0 being
+// component first
+void addComponents(const MDagPath& dagPath, ResultType type, size_t first, const std::vector<uint32_t>& masks, std::vector<std::string>& result)
+{
+    for (size_t i = 0; i < masks.size(); i++) {
+        uint32_t mask = masks[i];
+        for (unsigned int bit = 0; mask != 0; bit++, mask >>= 1) {
+            if ((mask & 1U) != 0) {
+                addComponent(dagPath, type, static_cast<int>(first + i * 32 + bit), result);
             }
         }
     }
-    return result;
 }
 
-std::vector<std::string> findNgons(std::vector<std::string>* paths)
+// Edges of the topology, given by their index in it, added with their index
+// in the mesh and in that order. Edges the mesh doesn't have are left out
+void addEdges(const MDagPath& dagPath, const MeshTopology& topology, std::vector<int> edges, std::vector<std::string>& result)
 {
-
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
-
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        MFnMesh mesh(dagPath);
-        int numPoly = mesh.numPolygons();
-
-        for (int i = 0; i < numPoly; i++) {
-            if (mesh.polygonVertexCount(i) >= 5) {
-                createResultString(dagPath, ResultType::Face, i, errorPath);
-                result.push_back(errorPath);
-            }
+    if (edges.empty()) {
+        return;
+    }
+    MeshEdgeLookup lookup(dagPath);
+    for (int& edge : edges) {
+        size_t e = static_cast<size_t>(edge);
+        edge = lookup.find(topology.edgeVertices[e * 2], topology.edgeVertices[e * 2 + 1], edge);
+    }
+    std::sort(edges.begin(), edges.end());
+    for (int edge : edges) {
+        if (edge >= 0) {
+            addComponent(dagPath, ResultType::Edge, edge, result);
         }
     }
-    return result;
 }
 
-std::vector<std::string> findNonManifoldEdges(std::vector<std::string>* paths)
+// Zero length edges read the edges of the topology rather than pulling them
+bool needsTopology(const CheckOptions& options)
 {
-    MSelectionList list;
+    return options.has(MeshCheckType::NON_MANIFOLD_EDGES) || options.has(MeshCheckType::LAMINA_FACES)
+        || options.has(MeshCheckType::MESH_BORDER) || options.has(MeshCheckType::BI_VALENT_FACES)
+        || options.has(MeshCheckType::UNUSED_VERTICES) || options.has(MeshCheckType::ZERO_LENGTH_EDGES);
+}
 
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
+// Checks which only depend on connectivity, read from the topology shared
+// by the checks of the mesh. Lamina faces are checked with the other face
+// checks, by chunks
+void checkTopology(const MDagPath& dagPath, const CheckOptions& options, const MeshTopology& topology, CheckResults& results)
+{
+    bool findNonManifoldEdges = options.has(MeshCheckType::NON_MANIFOLD_EDGES);
+    bool findBorderEdges = options.has(MeshCheckType::MESH_BORDER);
+    bool findBiValentFaces = options.has(MeshCheckType::BI_VALENT_FACES);
+    bool findUnusedVertices = options.has(MeshCheckType::UNUSED_VERTICES);
+
+    if (findNonManifoldEdges || findBorderEdges) {
+        std::vector<int> nonManifoldEdges;
+        std::vector<int> borderEdges;
+        size_t numEdges = topology.edgeFaces.offsets.size() - 1;
+        for (size_t i = 0; i < numEdges; i++) {
+            unsigned int faceCount = topology.edgeFaces.count(i);
+            if (findNonManifoldEdges && faceCount > 2) {
+                nonManifoldEdges.push_back(static_cast<int>(i));
+            }
+            if (findBorderEdges && faceCount == 1) {
+                borderEdges.push_back(static_cast<int>(i));
+            }
+        }
+        addEdges(dagPath, topology, std::move(nonManifoldEdges), results[static_cast<size_t>(MeshCheckType::NON_MANIFOLD_EDGES)]);
+        addEdges(dagPath, topology, std::move(borderEdges), results[static_cast<size_t>(MeshCheckType::MESH_BORDER)]);
     }
 
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-
-        for (MItMeshEdge edgeIter(dagPath); !edgeIter.isDone(); edgeIter.next()) {
-            int face_count;
-            edgeIter.numConnectedFaces(face_count);
-            if (face_count > 2) {
-                createResultString(dagPath, ResultType::Edge, edgeIter.index(), errorPath);
-                result.push_back(errorPath);
+    if (findBiValentFaces || findUnusedVertices) {
+        size_t numVertices = topology.vertexEdges.offsets.size() - 1;
+        for (size_t i = 0; i < numVertices; i++) {
+            unsigned int edgeCount = topology.vertexEdges.count(i);
+            if (findBiValentFaces && edgeCount == 2 && topology.vertexFaces.count(i) == 2) {
+                addComponent(dagPath, ResultType::Vertex, static_cast<int>(i), results[static_cast<size_t>(MeshCheckType::BI_VALENT_FACES)]);
+            }
+            if (findUnusedVertices && edgeCount == 0) {
+                addComponent(dagPath, ResultType::Vertex, static_cast<int>(i), results[static_cast<size_t>(MeshCheckType::UNUSED_VERTICES)]);
             }
         }
     }
-    return result;
 }
 
-std::vector<std::string> findLaminaFaces(std::vector<std::string>* paths)
+void hasVertexPntsAttr(const MDagPath& meshPath, std::vector<std::string>& result)
 {
-    MSelectionList list;
+    MDagPath dagPath(meshPath);
+    dagPath.extendToShape();
+    MFnMesh mesh(dagPath);
+    MPlug pntsArray = mesh.findPlug("pnts", false);
+    MDataHandle dataHandle = pntsArray.asMDataHandle();
+    MArrayDataHandle arrayDataHandle(dataHandle);
+    MDataHandle outputHandle;
 
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
+    MStatus status;
 
-    std::vector<std::string> result;
-    std::string errorPath;
+    unsigned int numElements = arrayDataHandle.elementCount();
 
-    unsigned int length = list.length();
+    while (numElements != 0) {
+        outputHandle = arrayDataHandle.outputValue();
 
-    MDagPath dagPath;
+        const float3& xyz = outputHandle.asFloat3();
 
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
+        if (xyz[0] != 0.0F || xyz[1] != 0.0F || xyz[2] != 0.0F) {
+            result.push_back(dagPath.fullPathName().asChar());
+            break;
+        }
 
-        for (MItMeshPolygon polyIter(dagPath); !polyIter.isDone(); polyIter.next()) {
-            if (polyIter.isLamina()) {
-                createResultString(dagPath, ResultType::Face, static_cast<int>(polyIter.index()), errorPath);
-                result.push_back(errorPath);
-            }
+        // end of iterator
+        status = arrayDataHandle.next();
+        if (status != MS::kSuccess) {
+            break;
         }
     }
-    return result;
+    pntsArray.destructHandle(dataHandle);
 }
 
-std::vector<std::string> findBiValentFaces(std::vector<std::string>* paths)
+void isEmptyGeometry(const MDagPath& dagPath, std::vector<std::string>& result)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
+    MFnMesh mesh(dagPath);
+    int numVerts = mesh.numVertices();
+    if (numVerts == 0) {
+        result.push_back(dagPath.fullPathName().asChar());
     }
+}
 
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    MIntArray connectedFaces;
-    MIntArray connectedEdges;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-
-        for (MItMeshVertex vtxIter(dagPath); !vtxIter.isDone(); vtxIter.next()) {
-            vtxIter.getConnectedFaces(connectedFaces);
-            vtxIter.getConnectedEdges(connectedEdges);
-
-            if (connectedFaces.length() == 2 && connectedEdges.length() == 2) {
-                createResultString(dagPath, ResultType::Vertex, vtxIter.index(), errorPath);
-                result.push_back(errorPath);
-            }
+void findInstances(const MDagPath& meshPath, std::vector<std::string>& result)
+{
+    MFnDagNode fnDag(meshPath);
+    if (fnDag.isInstanced()) {
+        MObject mObj = fnDag.parent(0);
+        MFnDagNode dataParent(mObj);
+        MString instanceSource = dataParent.fullPathName();
+        MDagPath dagPath(meshPath);
+        dagPath.pop(1);
+        MString hierarchyParent = dagPath.fullPathName();
+        if (hierarchyParent != instanceSource) {
+            result.push_back(dagPath.fullPathName().asChar());
         }
     }
-    return result;
 }
 
-std::vector<std::string> findZeroAreaFaces(std::vector<std::string>* paths, double maxFaceArea)
+void findConnections(const MDagPath& meshPath, std::vector<std::string>& result)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
-
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
+    static const std::vector<std::string> CON_LIST = {
+        "translateX",
+        "translateY",
+        "translateZ",
+        "rotateX",
+        "rotateY",
+        "rotateZ",
+        "rotateOrder",
+        "parentInverseMatrix",
+        "rotatePivot",
+        "rotatePivotTranslate"
+    };
 
-        for (MItMeshPolygon polyIter(dagPath); !polyIter.isDone(); polyIter.next()) {
-            double area;
-            polyIter.getArea(area);
-            if (area < maxFaceArea) {
-                createResultString(dagPath, ResultType::Face, static_cast<int>(polyIter.index()), errorPath);
-                result.push_back(errorPath);
-            }
+    MPlugArray plugs;
+
+    MDagPath dagPath(meshPath);
+    dagPath.pop(1);
+    MObject mObj = dagPath.node();
+    MFnDependencyNode fnDep(mObj);
+    fnDep.getConnections(plugs);
+    unsigned int numPlugs = plugs.length();
+    for (unsigned int j = 0; j < numPlugs; j++) {
+        MPlug p = plugs[j];
+        MString cn = p.partialName(false, false, false, false, false, true);
+        if (std::find(CON_LIST.begin(), CON_LIST.end(), cn.asChar()) != CON_LIST.end()) {
+            result.push_back(dagPath.fullPathName().asChar());
+            break;
         }
     }
-    return result;
 }
 
-std::vector<std::string> findMeshBorderEdges(std::vector<std::string>* paths)
-{
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
+// Checks which split a mesh into ranges of faces, edges or crease edges
+enum class ChunkType {
+    FACES,
+    EDGES,
+    CREASE_EDGES
+};
 
-    std::vector<std::string> result;
-    std::string errorPath;
+// Below this many elements a chunk costs more to schedule than to check, and
+// a mesh is checked whole by the task which pulled its arrays
+const size_t minChunkSize = 4096;
 
-    unsigned int length = list.length();
+bool hasFaceChecks(const CheckOptions& options)
+{
+    return options.has(MeshCheckType::TRIANGLES) || options.has(MeshCheckType::NGONS)
+        || options.has(MeshCheckType::ZERO_AREA_FACES) || options.has(MeshCheckType::LAMINA_FACES);
+}
 
-    MDagPath dagPath;
+// Arrays of one mesh read by the checks which are split into chunks. They are
+// pulled once per mesh, and only read by the chunks of the mesh
+struct MeshArrays {
+    // Faces and edges to check, 0 if none of their checks is requested
+    size_t numFaces;
+    size_t numEdges;
+    // Stays valid as long as the mesh is not modified, which the command never
+    // does. Pulled once so that chunks do not evaluate the mesh concurrently
+    const float* points;
+    // Only pulled when the mesh has no topology. Face i has vertices
+    // faceVertices[faceOffsets[i]] to faceVertices[faceOffsets[i + 1] - 1]
+    std::vector<unsigned int> faceOffsets;
+    std::vector<int> faceVertices;
+    std::vector<unsigned int> creaseEdges;
+    std::shared_ptr<const MeshTopology> topology;
+
+    MeshArrays()
+        : numFaces(0)
+        , numEdges(0)
+        , points(nullptr)
+    {
+    }
+
+    size_t getNumElements() const
+    {
+        return numFaces + numEdges + creaseEdges.size();
+    }
+
+    const std::vector<unsigned int>& getFaceOffsets() const
+    {
+        return topology != nullptr ? topology->faceEdges.offsets : faceOffsets;
+    }
+
+    const std::vector<int>& getFaceVertices() const
+    {
+        return topology != nullptr ? topology->faceVertices : faceVertices;
+    }
+};
+
+// Checks of faces, edges or crease edges begin to end of a mesh. Components
+// are added in index order, so the results of consecutive ranges only need to
+// be appended. Zero length edges are topology edges, appended to shortEdges.
+// Their mesh indices can be in another order, so they are only added once
+// all ranges of the mesh are done
+void checkRange(const MDagPath& dagPath, const MeshArrays& arrays, ChunkType type, size_t begin, size_t end,
+    const CheckOptions& options, CheckResults& results, std::vector<int>& shortEdges)
+{
+    size_t count = end - begin;
+    if (count == 0) {
+        return;
+    }
+
+    if (type == ChunkType::FACES) {
+        bool findTriangles = options.has(MeshCheckType::TRIANGLES);
+        bool findNgons = options.has(MeshCheckType::NGONS);
+        if (findTriangles || findNgons) {
+            const std::vector<unsigned int>& faceOffsets = arrays.getFaceOffsets();
+            for (size_t i = begin; i < end; i++) {
+                unsigned int faceCount = faceOffsets[i + 1] - faceOffsets[i];
+                if (findTriangles && faceCount == 3) {
+                    addComponent(dagPath, ResultType::Face, static_cast<int>(i), results[static_cast<size_t>(MeshCheckType::TRIANGLES)]);
+                }
+                if (findNgons && faceCount >= 5) {
+                    addComponent(dagPath, ResultType::Face, static_cast<int>(i), results[static_cast<size_t>(MeshCheckType::NGONS)]);
+                }
+            }
+        }
 
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
+        if (options.has(MeshCheckType::LAMINA_FACES)) {
+            for (size_t i = begin; i < end; i++) {
+                if (arrays.topology->isLamina(i)) {
+                    addComponent(dagPath, ResultType::Face, static_cast<int>(i), results[static_cast<size_t>(MeshCheckType::LAMINA_FACES)]);
+                }
+            }
+        }
 
-        for (MItMeshEdge edgeIter(dagPath); !edgeIter.isDone(); edgeIter.next()) {
-            if (edgeIter.onBoundary()) {
-                createResultString(dagPath, ResultType::Edge, edgeIter.index(), errorPath);
-                result.push_back(errorPath);
+        if (options.has(MeshCheckType::ZERO_AREA_FACES)) {
+            std::vector<uint32_t> masks(geometryKernel::getMaskSize(count));
+            geometryKernel::findSmallFaces(arrays.points, arrays.getFaceOffsets().data() + begin, arrays.getFaceVertices().data(),
+                count, options.maxFaceArea, masks.data());
+            addComponents(dagPath, ResultType::Face, begin, masks, results[static_cast<size_t>(MeshCheckType::ZERO_AREA_FACES)]);
+        }
+    } else if (type == ChunkType::EDGES) {
+        std::vector<uint32_t> masks(geometryKernel::getMaskSize(count));
+        geometryKernel::findShortEdges(arrays.points, arrays.topology->edgeVertices.data() + begin * 2, count,
+            options.minEdgeLength, masks.data());
+        for (size_t i = 0; i < masks.size(); i++) {
+            uint32_t mask = masks[i];
+            for (unsigned int bit = 0; mask != 0; bit++, mask >>= 1) {
+                if ((mask & 1U) != 0) {
+                    shortEdges.push_back(static_cast<int>(begin + i * 32 + bit));
+                }
             }
         }
+    } else {
+        for (size_t i = begin; i < end; i++) {
+            addComponent(dagPath, ResultType::Edge, static_cast<int>(arrays.creaseEdges[i]), results[static_cast<size_t>(MeshCheckType::CREASE_EDGE)]);
+        }
     }
-    return result;
 }
 
-std::vector<std::string> findCreaseEdges(std::vector<std::string>* paths)
+// Arrays of the checks split into chunks, one pull per array whatever the
+// number of checks reading it
+void pullMeshArrays(const MDagPath& dagPath, const CheckOptions& options, MeshArrays& arrays)
 {
-    MSelectionList list;
+    MFnMesh mesh(dagPath);
+
+    if (hasFaceChecks(options)) {
+        arrays.numFaces = static_cast<size_t>(mesh.numPolygons());
+    }
+
+    // Face checks read the face vertices of the topology when it is built
+    // anyway, and pull them otherwise
+    bool readsFaces = options.has(MeshCheckType::TRIANGLES) || options.has(MeshCheckType::NGONS)
+        || options.has(MeshCheckType::ZERO_AREA_FACES);
+    if (readsFaces && arrays.topology == nullptr) {
+        MIntArray counts;
+        MIntArray ids;
+        mesh.getVertices(counts, ids);
+        arrays.faceOffsets.resize(counts.length() + 1);
+        arrays.faceOffsets[0] = 0;
+        for (unsigned int i = 0; i < counts.length(); i++) {
+            arrays.faceOffsets[i + 1] = arrays.faceOffsets[i] + static_cast<unsigned int>(counts[i]);
+        }
 
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
+        if (options.has(MeshCheckType::ZERO_AREA_FACES)) {
+            arrays.faceVertices.resize(ids.length());
+            ids.get(arrays.faceVertices.data());
+        }
     }
 
-    unsigned int length = list.length();
-
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    MDagPath dagPath;
+    if (options.has(MeshCheckType::ZERO_LENGTH_EDGES)) {
+        arrays.numEdges = arrays.topology->edgeVertices.size() / 2;
+    }
 
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        MFnMesh mesh(dagPath);
+    if (options.has(MeshCheckType::ZERO_AREA_FACES) || options.has(MeshCheckType::ZERO_LENGTH_EDGES)) {
+        arrays.points = mesh.getRawPoints(nullptr);
+    }
 
+    if (options.has(MeshCheckType::CREASE_EDGE)) {
         MUintArray edgeIds;
         MDoubleArray creaseData;
         mesh.getCreaseEdges(edgeIds, creaseData);
-
-        unsigned int edgeIdLength = edgeIds.length();
-
-        for (unsigned int j = 0; j < edgeIdLength; j++) {
-            createResultString(dagPath, ResultType::Edge, static_cast<int>(edgeIds[j]), errorPath);
-            result.push_back(errorPath);
-        }
+        arrays.creaseEdges.resize(edgeIds.length());
+        edgeIds.get(arrays.creaseEdges.data());
     }
-    return result;
 }
 
-std::vector<std::string> findZeroLengthEdges(std::vector<std::string>* paths, double minEdgeLength)
+// All checks of one mesh which are not split into chunks, and the arrays of
+// the split ones. Connectivity is built once for all topology checks. Meshes
+// too small to be worth splitting are checked whole right away, and leave no
+// arrays behind
+void checkMesh(const MDagPath& dagPath, const CheckOptions& options, TopologyCache& cache, CheckResults& results, MeshArrays& arrays)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
-
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        for (MItMeshEdge edgeIter(dagPath); !edgeIter.isDone(); edgeIter.next()) {
-            double length;
-            edgeIter.getLength(length);
-            if (length < minEdgeLength) {
-                createResultString(dagPath, ResultType::Edge, static_cast<int>(edgeIter.index()), errorPath);
-                result.push_back(errorPath);
-            }
+    if (needsTopology(options)) {
+        arrays.topology = cache.getTopology(dagPath);
+        checkTopology(dagPath, options, *arrays.topology, results);
+    }
+
+    pullMeshArrays(dagPath, options, arrays);
+    if (arrays.getNumElements() <= minChunkSize) {
+        std::vector<int> shortEdges;
+        checkRange(dagPath, arrays, ChunkType::FACES, 0, arrays.numFaces, options, results, shortEdges);
+        checkRange(dagPath, arrays, ChunkType::EDGES, 0, arrays.numEdges, options, results, shortEdges);
+        checkRange(dagPath, arrays, ChunkType::CREASE_EDGES, 0, arrays.creaseEdges.size(), options, results, shortEdges);
+        if (!shortEdges.empty()) {
+            addEdges(dagPath, *arrays.topology, std::move(shortEdges), results[static_cast<size_t>(MeshCheckType::ZERO_LENGTH_EDGES)]);
         }
+        arrays = MeshArrays();
     }
-    return result;
-}
-
-std::vector<std::string> hasVertexPntsAttr(std::vector<std::string>* paths)
-{
-    MSelectionList list;
 
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
+    if (options.has(MeshCheckType::UNFROZEN_VERTICES)) {
+        hasVertexPntsAttr(dagPath, results[static_cast<size_t>(MeshCheckType::UNFROZEN_VERTICES)]);
     }
-
-    std::vector<std::string> result;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    MStatus status;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        dagPath.extendToShape();
-        MFnDagNode dagNode(dagPath);
-        MFnMesh mesh(dagPath);
-        MPlug pntsArray = mesh.findPlug("pnts", false);
-        MDataHandle dataHandle = pntsArray.asMDataHandle();
-        MArrayDataHandle arrayDataHandle(dataHandle);
-        MDataHandle outputHandle;
-
-        unsigned int numElements = arrayDataHandle.elementCount();
-
-        if (numElements == 0) {
-            continue;
-        }
-
-        while (true) {
-            outputHandle = arrayDataHandle.outputValue();
-
-            const float3& xyz = outputHandle.asFloat3();
-
-            if (xyz[0] != 0.0) {
-                result.push_back(dagPath.fullPathName().asChar());
-                break;
-            }
-            if (xyz[1] != 0.0) {
-                result.push_back(dagPath.fullPathName().asChar());
-                break;
-            }
-            if (xyz[2] != 0.0) {
-                result.push_back(dagPath.fullPathName().asChar());
-                break;
-            }
-
-            // end of iterator
-            status = arrayDataHandle.next();
-            if (status != MS::kSuccess) {
-                break;
-            }
-        }
-        pntsArray.destructHandle(dataHandle);
+    if (options.has(MeshCheckType::EMPTY_GEOMETRY)) {
+        isEmptyGeometry(dagPath, results[static_cast<size_t>(MeshCheckType::EMPTY_GEOMETRY)]);
+    }
+    if (options.has(MeshCheckType::INSTANCE)) {
+        findInstances(dagPath, results[static_cast<size_t>(MeshCheckType::INSTANCE)]);
+    }
+    if (options.has(MeshCheckType::CONNECTIONS)) {
+        findConnections(dagPath, results[static_cast<size_t>(MeshCheckType::CONNECTIONS)]);
     }
-    return result;
 }
 
-std::vector<std::string> isEmptyGeometry(std::vector<std::string>* paths)
+// Task of the first pass, over meshes begin to end of the hierarchy. Each
+// mesh has its own results and arrays, so tasks share nothing
+void checkMeshes(const std::vector<MDagPath>* hierarchy, size_t begin, size_t end, const CheckOptions* options,
+    TopologyCache* cache, std::vector<CheckResults>* meshResults, std::vector<MeshArrays>* meshArrays)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
+    for (size_t i = begin; i < end; i++) {
+        (*meshResults)[i].resize(numCheckTypes);
+        checkMesh((*hierarchy)[i], *options, *cache, (*meshResults)[i], (*meshArrays)[i]);
     }
+}
 
-    std::vector<std::string> result;
-
-    unsigned int length = list.length();
-    MDagPath dagPath;
+// Range of faces, edges or crease edges of one mesh
+struct Chunk {
+    size_t mesh;
+    ChunkType type;
+    size_t begin;
+    size_t end;
+};
 
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        MFnMesh mesh(dagPath);
-        int numVerts = mesh.numVertices();
-        if (numVerts == 0) {
-            result.push_back(dagPath.fullPathName().asChar());
-        }
+void addChunks(size_t mesh, ChunkType type, size_t count, size_t chunkSize, std::vector<Chunk>& chunks)
+{
+    for (size_t begin = 0; begin < count; begin += chunkSize) {
+        chunks.push_back({ mesh, type, begin, std::min(begin + chunkSize, count) });
     }
-    return result;
 }
 
-std::vector<std::string> findUnusedVertices(std::vector<std::string>* paths)
+// Chunks of every mesh left by the first pass, in hierarchy order, and the
+// first chunk of each task. The chunk size grows with the elements of the
+// whole call so that every task gets a few chunks. Consecutive small chunks
+// go to the same task
+void planChunks(const std::vector<MeshArrays>& meshArrays, size_t numTasks, std::vector<Chunk>& chunks, std::vector<size_t>& taskBegins)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
+    size_t numElements = 0;
+    for (const MeshArrays& arrays : meshArrays) {
+        numElements += arrays.getNumElements();
     }
+    size_t chunkSize = std::max(numElements / (numTasks * 4) + 1, minChunkSize);
 
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-    MDagPath dagPath;
-
-    for (unsigned int i = 0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        int edgeCount;
-
-        for (MItMeshVertex vtxIter(dagPath); !vtxIter.isDone(); vtxIter.next()) {
-            vtxIter.numConnectedEdges(edgeCount);
+    for (size_t i = 0; i < meshArrays.size(); i++) {
+        addChunks(i, ChunkType::FACES, meshArrays[i].numFaces, chunkSize, chunks);
+        addChunks(i, ChunkType::EDGES, meshArrays[i].numEdges, chunkSize, chunks);
+        addChunks(i, ChunkType::CREASE_EDGES, meshArrays[i].creaseEdges.size(), chunkSize, chunks);
+    }
 
-            if (edgeCount == 0) {
-                createResultString(dagPath, ResultType::Vertex, vtxIter.index(), errorPath);
-                result.push_back(errorPath);
-            }
+    size_t taskSize = chunkSize;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (taskSize >= chunkSize) {
+            taskBegins.push_back(i);
+            taskSize = 0;
         }
+        taskSize += chunks[i].end - chunks[i].begin;
     }
-    return result;
+    taskBegins.push_back(chunks.size());
 }
 
-std::vector<std::string> findInstances(std::vector<std::string>* paths)
+// Results of one chunk. Zero length edges are left as topology edges, to be
+// added with those of the other chunks of the mesh
+struct ChunkResults {
+    CheckResults results;
+    std::vector<int> shortEdges;
+};
+
+// Task of the second pass, over chunks begin to end. Results are per chunk
+// so that they can be merged in mesh order
+std::vector<ChunkResults> checkChunks(const std::vector<MDagPath>* hierarchy, const std::vector<MeshArrays>* meshArrays,
+    const std::vector<Chunk>* chunks, size_t begin, size_t end, const CheckOptions* options)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
-
-    std::vector<std::string> result;
-    std::string errorPath;
-
-    unsigned int length = list.length();
-    MDagPath dagPath;
-    MFnDagNode fnDag;
-
-    for (unsigned int i=0; i < length; i++) {
-        list.getDagPath(i, dagPath);
-        fnDag.setObject(dagPath);
-        if (fnDag.isInstanced()) {
-            MObject mObj = fnDag.parent(0);
-            MFnDagNode dataParent(mObj);
-            MString instanceSource = dataParent.fullPathName();
-            dagPath.pop(1);
-            MString hierarchyParent = dagPath.fullPathName();
-            if (hierarchyParent != instanceSource) {
-                result.push_back(dagPath.fullPathName().asChar());
-            }
-        }
-    }
-
-    return result;
+    std::vector<ChunkResults> results(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        const Chunk& chunk = (*chunks)[i];
+        ChunkResults& chunkResults = results[i - begin];
+        chunkResults.results.resize(numCheckTypes);
+        checkRange((*hierarchy)[chunk.mesh], (*meshArrays)[chunk.mesh], chunk.type, chunk.begin, chunk.end, *options,
+            chunkResults.results, chunkResults.shortEdges);
+    }
+    return results;
 }
 
-std::vector<std::string> findConnections(std::vector<std::string>* paths)
+void appendResults(CheckResults& source, CheckResults& destination)
 {
-    MSelectionList list;
-
-    for (auto& p : *paths) {
-        MString mPath(p.c_str());
-        list.add(mPath);
-    }
-    std::vector<std::string> CON_LIST = {
-        "translateX",
-        "translateY",
-        "translateZ",
-        "rotateX",
-        "rotateY",
-        "rotateZ",
-        "rotateOrder",
-        "parentInverseMatrix",
-        "rotatePivot",
-        "rotatePivotTranslate"
-    };
-
-    std::vector<std::string> result;
-
-    unsigned int length = list.length();
-
-    MDagPath dagPath;
-
-    for (unsigned int i=0; i < length; i++) {
-
-        MPlugArray plugs;
-
-        list.getDagPath(i, dagPath);
-        dagPath.pop(1);
-        MObject mObj = dagPath.node();
-        MFnDependencyNode fnDep(mObj);
-        fnDep.getConnections(plugs);
-        unsigned int numPlugs = plugs.length();
-        for (unsigned int j=0; j<numPlugs; j++) {
-            MPlug p = plugs[j];
-            MString cn = p.partialName(false, false, false, false, false, true);
-            if (std::find(CON_LIST.begin(), CON_LIST.end(), cn.asChar()) != CON_LIST.end()) {
-                result.push_back(dagPath.fullPathName().asChar());
-                break;
-            }
-        }
+    for (size_t i = 0; i < numCheckTypes; i++) {
+        destination[i].insert(destination[i].end(), std::make_move_iterator(source[i].begin()), std::make_move_iterator(source[i].end()));
     }
-    return result;
 }
 
 } // namespace
@@ -533,6 +536,16 @@ MStatus MeshChecker::doIt(const MArgList& args)
     MStatus status;
     MArgDatabase argData(syntax(), args);
 
+    // The memory report of the shared topology cache needs no mesh
+    if (argData.isFlagSet("-cacheReport")) {
+        MStringArray report;
+        for (const auto& entry : TopologyCache::get().getMemoryReport()) {
+            report.append((entry.first + " " + std::to_string(entry.second)).c_str());
+        }
+        setResult(report);
+        return MS::kSuccess;
+    }
+
     // if argument is not provided use selection list
     MSelectionList selection;
     if (args.length() == 0) {
@@ -550,105 +563,142 @@ MStatus MeshChecker::doIt(const MArgList& args)
     selection.getDagPath(0, path);
 
     // argument parsing
-    MeshCheckType check_type;
-
-    if (argData.isFlagSet("-check")) {
-        unsigned int check_value;
-        argData.getFlagArgument("-check", 0, check_value);
+    CheckOptions options = {};
+    std::vector<MeshCheckType> checkTypes;
 
-        check_type = static_cast<MeshCheckType>(check_value);
-
-        // TODO check if exeds value
+    if (argData.isFlagSet("-all")) {
+        for (size_t i = 0; i < numCheckTypes; i++) {
+            checkTypes.push_back(static_cast<MeshCheckType>(i));
+        }
+    } else if (argData.isFlagSet("-check")) {
+        MArgList checkArgs;
+        unsigned int numUses = argData.numberOfFlagUses("-check");
+        for (unsigned int i = 0; i < numUses; i++) {
+            argData.getFlagArgumentList("-check", i, checkArgs);
+            unsigned int argIndex = 0;
+            int checkValue = checkArgs.asInt(argIndex);
+
+            if (checkValue < 0 || static_cast<size_t>(checkValue) >= numCheckTypes) {
+                MGlobal::displayError("Invalid check number");
+                return MS::kFailure;
+            }
+            MeshCheckType checkType = static_cast<MeshCheckType>(checkValue);
+            if (std::find(checkTypes.begin(), checkTypes.end(), checkType) == checkTypes.end()) {
+                checkTypes.push_back(checkType);
+            }
+        }
     } else {
         MGlobal::displayError("Check type required.");
         return MS::kFailure;
     }
 
-    std::vector<std::string> hierarchy;
-    buildHierarchy(path, hierarchy);
+    for (MeshCheckType checkType : checkTypes) {
+        options.isRequested[static_cast<size_t>(checkType)] = true;
+    }
 
-    // Number of threads to use
-    size_t numTasks = 8;
+    options.maxFaceArea = 0.000001;
+    if (argData.isFlagSet("-maxFaceArea"))
+        argData.getFlagArgument("-maxFaceArea", 0, options.maxFaceArea);
 
-    // Split sub-vectors to pass to each thread
-    std::vector<std::vector<std::string>> splitGroups;
+    options.minEdgeLength = 0.000001;
+    if (argData.isFlagSet("-minEdgeLength"))
+        argData.getFlagArgument("-minEdgeLength", 0, options.minEdgeLength);
 
-    splitGroups.resize(numTasks);
-    size_t n = hierarchy.size() / numTasks + 1;
-    size_t idCounter = 0;
-    for (size_t groupID = 0; groupID < numTasks; groupID++) {
-        splitGroups[groupID].reserve(n);
-    }
+    bool cacheMode = false;
+    if (argData.isFlagSet("-cache"))
+        argData.getFlagArgument("-cache", 0, cacheMode);
 
-    for (size_t a = 0; a < numTasks; a++) {
-        for (size_t b = 0; b < n; b++) {
-            if (idCounter == hierarchy.size()) {
-                break;
-            }
-            splitGroups[a].emplace_back(hierarchy[idCounter]);
-            idCounter++;
-        }
-    }
+    // In megabytes
+    double maxCacheMemory = 1024.0;
+    if (argData.isFlagSet("-maxCacheMemory"))
+        argData.getFlagArgument("-maxCacheMemory", 0, maxCacheMemory);
 
-    ThreadPool pool(8);
-    std::vector<std::future<std::vector<std::string>>> results;
+    // Topologies are shared by all checks and instances of this call, and
+    // kept for the next calls in cache mode
+    TopologyCache callCache;
+    TopologyCache& cache = cacheMode ? TopologyCache::get() : callCache;
 
-    double maxFaceArea { 0.000001 };
-    if (argData.isFlagSet("-maxFaceArea"))
-        argData.getFlagArgument("-maxFaceArea", 0, maxFaceArea);
+    // Dag paths are resolved once here instead of from names in every task
+    std::vector<MDagPath> hierarchy;
+    buildHierarchy(path, hierarchy);
 
-    double minEdgeLength = 0.000001;
-    if (argData.isFlagSet("-minEdgeLength"))
-        argData.getFlagArgument("-minEdgeLength", 0, minEdgeLength);
+    // Number of threads to use
+    size_t numTasks = 8;
+    ThreadPool pool(8);
+
+    // First pass over the meshes: checks which are not split, topologies,
+    // and the arrays of the split checks
+    std::vector<CheckResults> meshResults(hierarchy.size());
+    std::vector<MeshArrays> meshArrays(hierarchy.size());
+    std::vector<std::future<void>> meshTasks;
 
+    size_t n = hierarchy.size() / numTasks + 1;
     for (size_t i = 0; i < numTasks; i++) {
-        if (check_type == MeshCheckType::TRIANGLES) {
-            results.push_back(pool.enqueue(findTriangles, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::NGONS) {
-            results.push_back(pool.enqueue(findNgons, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::NON_MANIFOLD_EDGES) {
-            results.push_back(pool.enqueue(findNonManifoldEdges, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::LAMINA_FACES) {
-            results.push_back(pool.enqueue(findLaminaFaces, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::BI_VALENT_FACES) {
-            results.push_back(pool.enqueue(findBiValentFaces, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::ZERO_AREA_FACES) {
-            results.push_back(pool.enqueue(findZeroAreaFaces, &splitGroups[i], maxFaceArea));
-        } else if (check_type == MeshCheckType::MESH_BORDER) {
-            results.push_back(pool.enqueue(findMeshBorderEdges, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::CREASE_EDGE) {
-            results.push_back(pool.enqueue(findCreaseEdges, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::ZERO_LENGTH_EDGES) {
-            results.push_back(pool.enqueue(findZeroLengthEdges, &splitGroups[i], minEdgeLength));
-        } else if (check_type == MeshCheckType::UNFROZEN_VERTICES) {
-            results.push_back(pool.enqueue(hasVertexPntsAttr, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::EMPTY_GEOMETRY) {
-            results.push_back(pool.enqueue(isEmptyGeometry, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::UNUSED_VERTICES) {
-            results.push_back(pool.enqueue(findUnusedVertices, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::INSTANCE) {
-            results.push_back(pool.enqueue(findInstances, &splitGroups[i]));
-        } else if (check_type == MeshCheckType::CONNECTIONS) {
-            results.push_back(pool.enqueue(findConnections, &splitGroups[i]));
-        } else {
-            MGlobal::displayError("Invalid check number");
-            return MS::kFailure;
+        size_t begin = std::min(i * n, hierarchy.size());
+        size_t end = std::min(begin + n, hierarchy.size());
+        meshTasks.push_back(pool.enqueue(checkMeshes, &hierarchy, begin, end, &options, &cache, &meshResults, &meshArrays));
+    }
+    for (auto&& task : meshTasks) {
+        task.get();
+    }
+
+    // Second pass over chunks of faces and edges, so that a single large
+    // mesh keeps every thread busy
+    std::vector<Chunk> chunks;
+    std::vector<size_t> taskBegins;
+    planChunks(meshArrays, numTasks, chunks, taskBegins);
+
+    std::vector<std::future<std::vector<ChunkResults>>> chunkTasks;
+    for (size_t i = 0; i + 1 < taskBegins.size(); i++) {
+        chunkTasks.push_back(pool.enqueue(checkChunks, &hierarchy, &meshArrays, &chunks, taskBegins[i], taskBegins[i + 1], &options));
+    }
+
+    std::vector<ChunkResults> chunkResults;
+    chunkResults.reserve(chunks.size());
+    for (auto&& task : chunkTasks) {
+        std::vector<ChunkResults> taskResults = task.get();
+        std::move(taskResults.begin(), taskResults.end(), std::back_inserter(chunkResults));
+    }
+
+    // Results of each mesh, then of its chunks, keep the hierarchy and index
+    // order of a single pass. Zero length edges of all chunks of a mesh are
+    // sorted together, in the order of the mesh
+    CheckResults intermediateResult(numCheckTypes);
+    size_t chunkIndex = 0;
+    for (size_t i = 0; i < hierarchy.size(); i++) {
+        appendResults(meshResults[i], intermediateResult);
+        std::vector<int> shortEdges;
+        for (; chunkIndex < chunks.size() && chunks[chunkIndex].mesh == i; chunkIndex++) {
+            appendResults(chunkResults[chunkIndex].results, intermediateResult);
+            shortEdges.insert(shortEdges.end(), chunkResults[chunkIndex].shortEdges.begin(), chunkResults[chunkIndex].shortEdges.end());
+        }
+        if (!shortEdges.empty()) {
+            addEdges(hierarchy[i], *meshArrays[i].topology, std::move(shortEdges),
+                intermediateResult[static_cast<size_t>(MeshCheckType::ZERO_LENGTH_EDGES)]);
         }
     }
 
-    std::vector<std::string> intermediateResult;
-
-    for (auto&& result : results) {
-        std::vector<std::string> temp = result.get();
-        for (auto& r : temp) {
-            intermediateResult.push_back(r);
-        }
+    if (cacheMode) {
+        cache.endRun(static_cast<size_t>(std::max(maxCacheMemory, 0.0) * 1024.0 * 1024.0));
     }
 
     MStringArray outputResult;
 
-    for (std::string& path : intermediateResult) {
-        outputResult.append(path.c_str());
+    // A single check returns its paths as before. Several checks return one
+    // string per check, in the requested order: the check number followed by
+    // its paths, separated by spaces
+    if (checkTypes.size() == 1 && !argData.isFlagSet("-all")) {
+        for (std::string& path : intermediateResult[static_cast<size_t>(checkTypes[0])]) {
+            outputResult.append(path.c_str());
+        }
+    } else {
+        for (MeshCheckType checkType : checkTypes) {
+            std::string group = std::to_string(static_cast<int>(checkType));
+            for (std::string& path : intermediateResult[static_cast<size_t>(checkType)]) {
+                group += " " + path;
+            }
+            outputResult.append(group.c_str());
+        }
     }
 
     setResult(outputResult);
@@ -681,9 +731,14 @@ MSyntax MeshChecker::newSyntax()
     MSyntax syntax;
     syntax.addArg(MSyntax::kString);
     syntax.addFlag("-c", "-check", MSyntax::kUnsigned);
+    syntax.makeFlagMultiUse("-check");
+    syntax.addFlag("-a", "-all", MSyntax::kNoArg);
     syntax.addFlag("-mfa", "-maxFaceArea", MSyntax::kDouble);
     syntax.addFlag("-mel", "-minEdgeLength", MSyntax::kDouble);
     syntax.addFlag("-fix", "-doFix", MSyntax::kBoolean);
+    syntax.addFlag("-ca", "-cache", MSyntax::kBoolean);
+    syntax.addFlag("-mcm", "-maxCacheMemory", MSyntax::kDouble);
+    syntax.addFlag("-cr", "-cacheReport", MSyntax::kNoArg);
     return syntax;
 }
 
@@ -0,0 +1,211 @@
+#include "meshTopology.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Elements of all lists of in, listed by element instead. Items of each new
+// list are in increasing order. Negative items are skipped
+void transpose(const AdjacencyList& in, size_t numElements, AdjacencyList& out)
+{
+    out.offsets.assign(numElements + 1, 0);
+    for (int item : in.items) {
+        if (item >= 0) {
+            out.offsets[static_cast<size_t>(item) + 1]++;
+        }
+    }
+    for (size_t i = 0; i < numElements; i++) {
+        out.offsets[i + 1] += out.offsets[i];
+    }
+
+    out.items.resize(out.offsets[numElements]);
+    std::vector<unsigned int> next(out.offsets.begin(), out.offsets.end() - 1);
+    size_t numLists = in.offsets.size() - 1;
+    for (size_t i = 0; i < numLists; i++) {
+        for (const int* item = in.begin(i); item != in.end(i); item++) {
+            if (*item >= 0) {
+                out.items[next[static_cast<size_t>(*item)]++] = static_cast<int>(i);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void MeshTopology::build(const std::vector<int>& faceCounts, std::vector<int> faceVertices,
+    std::vector<int> edges, size_t numVertices)
+{
+    size_t numEdges = edges.size() / 2;
+
+    // The edge vertices are lent to a list of two vertices per edge, to be
+    // transposed like the faces
+    AdjacencyList edgeList;
+    edgeList.offsets.resize(numEdges + 1);
+    for (size_t i = 0; i <= numEdges; i++) {
+        edgeList.offsets[i] = static_cast<unsigned int>(i * 2);
+    }
+    edgeList.items = std::move(edges);
+    transpose(edgeList, numVertices, vertexEdges);
+    edgeVertices = std::move(edgeList.items);
+
+    AdjacencyList faceList;
+    faceList.offsets.resize(faceCounts.size() + 1);
+    faceList.offsets[0] = 0;
+    for (size_t i = 0; i < faceCounts.size(); i++) {
+        faceList.offsets[i + 1] = faceList.offsets[i] + static_cast<unsigned int>(faceCounts[i]);
+    }
+    faceList.items = std::move(faceVertices);
+    transpose(faceList, numVertices, vertexFaces);
+
+    // The edge between two corners of a face is one of the few edges of
+    // the first corner. Edges not found are left at -1
+    faceEdges.offsets = faceList.offsets;
+    faceEdges.items.assign(faceList.items.size(), -1);
+    for (size_t i = 0; i < faceCounts.size(); i++) {
+        const int* corners = faceList.begin(i);
+        unsigned int numCorners = faceList.count(i);
+        for (unsigned int j = 0; j < numCorners; j++) {
+            int v0 = corners[j];
+            int v1 = corners[(j + 1) % numCorners];
+            size_t vertex = static_cast<size_t>(v0);
+            for (const int* edge = vertexEdges.begin(vertex); edge != vertexEdges.end(vertex); edge++) {
+                size_t e = static_cast<size_t>(*edge);
+                int other = edgeVertices[e * 2] == v0 ? edgeVertices[e * 2 + 1] : edgeVertices[e * 2];
+                if (other == v1) {
+                    faceEdges.items[faceList.offsets[i] + j] = *edge;
+                    break;
+                }
+            }
+        }
+    }
+
+    transpose(faceEdges, numEdges, edgeFaces);
+    this->faceVertices = std::move(faceList.items);
+}
+
+bool MeshTopology::isLamina(size_t face) const
+{
+    if (faceEdges.count(face) == 0) {
+        return false;
+    }
+    // Edges not found between two face vertices are -1. Whether another face
+    // shares such an edge can't be told, so the face isn't taken as lamina
+    for (const int* edge = faceEdges.begin(face); edge != faceEdges.end(face); edge++) {
+        if (*edge < 0) {
+            return false;
+        }
+    }
+
+    // Another face on the first edge has to be on all others
+    size_t firstEdge = static_cast<size_t>(*faceEdges.begin(face));
+    for (const int* other = edgeFaces.begin(firstEdge); other != edgeFaces.end(firstEdge); other++) {
+        size_t otherFace = static_cast<size_t>(*other);
+        if (otherFace == face || faceEdges.count(otherFace) != faceEdges.count(face)) {
+            continue;
+        }
+        // Faces of an edge are in increasing order
+        bool isShared = true;
+        for (const int* edge = faceEdges.begin(face) + 1; isShared && edge != faceEdges.end(face); edge++) {
+            size_t e = static_cast<size_t>(*edge);
+            isShared = std::binary_search(edgeFaces.begin(e), edgeFaces.end(e), *other);
+        }
+        if (isShared) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t MeshTopology::getMemorySize() const
+{
+    return (edgeVertices.capacity() + faceVertices.capacity()) * sizeof(int) + faceEdges.getMemorySize()
+        + edgeFaces.getMemorySize() + vertexFaces.getMemorySize() + vertexEdges.getMemorySize();
+}
+
+void EdgeTable::build(std::vector<int> edges, size_t numVertices)
+{
+    edgeVertices = std::move(edges);
+    size_t numEdges = edgeVertices.size() / 2;
+    vertexEdges.offsets.assign(numVertices + 1, 0);
+    for (size_t i = 0; i < numEdges; i++) {
+        vertexEdges.offsets[static_cast<size_t>(std::min(edgeVertices[i * 2], edgeVertices[i * 2 + 1])) + 1]++;
+    }
+    for (size_t i = 0; i < numVertices; i++) {
+        vertexEdges.offsets[i + 1] += vertexEdges.offsets[i];
+    }
+    vertexEdges.items.resize(numEdges);
+    std::vector<unsigned int> next(vertexEdges.offsets.begin(), vertexEdges.offsets.end() - 1);
+    for (size_t i = 0; i < numEdges; i++) {
+        vertexEdges.items[next[static_cast<size_t>(std::min(edgeVertices[i * 2], edgeVertices[i * 2 + 1]))]++] = static_cast<int>(i);
+    }
+}
+
+int EdgeTable::find(int v0, int v1) const
+{
+    size_t lower = static_cast<size_t>(std::min(v0, v1));
+    int upper = std::max(v0, v1);
+    if (lower + 1 >= vertexEdges.offsets.size()) {
+        return -1;
+    }
+    for (const int* edge = vertexEdges.begin(lower); edge != vertexEdges.end(lower); edge++) {
+        size_t e = static_cast<size_t>(*edge);
+        if (std::max(edgeVertices[e * 2], edgeVertices[e * 2 + 1]) == upper) {
+            return *edge;
+        }
+    }
+    return -1;
+}
+
+void findEdges(const std::vector<int>& faceCounts, const std::vector<int>& faceVertices,
+    size_t numVertices, std::vector<int>& edges)
+{
+    // Vertex after each corner of a face, which the edge of the corner leads to
+    size_t numCorners = faceVertices.size();
+    std::vector<int> nextVertices(numCorners);
+    size_t first = 0;
+    for (int count : faceCounts) {
+        size_t numFaceCorners = static_cast<size_t>(count);
+        for (size_t j = 0; j < numFaceCorners; j++) {
+            nextVertices[first + j] = faceVertices[first + (j + 1) % numFaceCorners];
+        }
+        first += numFaceCorners;
+    }
+
+    // Corners listed by the lower vertex of their edge, in corner order
+    AdjacencyList cornerList;
+    cornerList.offsets.assign(numVertices + 1, 0);
+    for (size_t i = 0; i < numCorners; i++) {
+        cornerList.offsets[static_cast<size_t>(std::min(faceVertices[i], nextVertices[i])) + 1]++;
+    }
+    for (size_t i = 0; i < numVertices; i++) {
+        cornerList.offsets[i + 1] += cornerList.offsets[i];
+    }
+    cornerList.items.resize(numCorners);
+    std::vector<unsigned int> next(cornerList.offsets.begin(), cornerList.offsets.end() - 1);
+    for (size_t i = 0; i < numCorners; i++) {
+        cornerList.items[next[static_cast<size_t>(std::min(faceVertices[i], nextVertices[i]))]++] = static_cast<int>(i);
+    }
+
+    // The first corner of an edge adds it, and marks the later corners of
+    // the same edge, which are among the few corners of its lower vertex
+    std::vector<char> isFound(numCorners, 0);
+    edges.clear();
+    for (size_t i = 0; i < numCorners; i++) {
+        if (isFound[i] != 0) {
+            continue;
+        }
+        int v0 = faceVertices[i];
+        int v1 = nextVertices[i];
+        edges.push_back(v0);
+        edges.push_back(v1);
+        size_t lower = static_cast<size_t>(std::min(v0, v1));
+        int upper = std::max(v0, v1);
+        for (const int* corner = cornerList.begin(lower); corner != cornerList.end(lower); corner++) {
+            size_t c = static_cast<size_t>(*corner);
+            if (c > i && std::max(faceVertices[c], nextVertices[c]) == upper) {
+                isFound[c] = 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Elements adjacent to each element of a mesh, in compressed sparse row
+// form. Items of element i are items[offsets[i]] to items[offsets[i + 1] - 1]
+struct AdjacencyList {
+    std::vector<unsigned int> offsets;
+    std::vector<int> items;
+
+    unsigned int count(size_t i) const
+    {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    const int* begin(size_t i) const
+    {
+        return items.data() + offsets[i];
+    }
+
+    const int* end(size_t i) const
+    {
+        return items.data() + offsets[i + 1];
+    }
+
+    size_t getMemorySize() const
+    {
+        return offsets.capacity() * sizeof(unsigned int) + items.capacity() * sizeof(int);
+    }
+};
+
+// Connectivity of one mesh, worked out in linear time from the bulk arrays
+// of the mesh rather than asked element by element to the mesh iterators.
+// A face uses each of its vertices and edges only once in Maya, so the
+// faces of a vertex or an edge are distinct
+struct MeshTopology {
+    // Two vertices of each edge, as findEdges or the mesh lists them
+    std::vector<int> edgeVertices;
+    // Vertices of each face, one face after another. Those of face i start
+    // at faceEdges.offsets[i], like its edges
+    std::vector<int> faceVertices;
+    // Edges of each face, in the order of the face vertices: edge i joins
+    // face vertex i and i + 1
+    AdjacencyList faceEdges;
+    AdjacencyList edgeFaces;
+    AdjacencyList vertexFaces;
+    AdjacencyList vertexEdges;
+
+    // faceCounts and faceVertices are the vertex count of each face and the
+    // vertices of all faces one after another, as MFnMesh::getVertices
+    // returns them. edges holds the two vertices of each edge
+    void build(const std::vector<int>& faceCounts, std::vector<int> faceVertices,
+        std::vector<int> edges, size_t numVertices);
+
+    // Faces sharing all of their edges with another face. Faces with an edge
+    // that wasn't found are never lamina
+    bool isLamina(size_t face) const;
+
+    // Bytes held by the arrays
+    size_t getMemorySize() const;
+};
+
+// Edges listed by their lower vertex, to find an edge from its two vertices
+struct EdgeTable {
+    // Two vertices of each edge, one edge after another
+    std::vector<int> edgeVertices;
+    AdjacencyList vertexEdges;
+
+    void build(std::vector<int> edges, size_t numVertices);
+
+    // Edge from v0 to v1, -1 if there is none
+    int find(int v0, int v1) const;
+};
+
+// Two vertices of each edge of the faces, one edge after another. An edge
+// joins two vertices following each other in a face, and edges are numbered
+// in the order the faces first use them. That is the numbering of a mesh
+// which Maya built in one go from the same arrays, but not always of a mesh
+// edited since
+void findEdges(const std::vector<int>& faceCounts, const std::vector<int>& faceVertices,
+    size_t numVertices, std::vector<int>& edges);
@@ -0,0 +1,260 @@
+#include "topologyCache.hpp"
+
+#include <maya/MFnDagNode.h>
+#include <maya/MFnMesh.h>
+#include <maya/MIntArray.h>
+
+#include <algorithm>
+
+namespace {
+
+uint64_t mix(uint64_t hash, uint64_t value)
+{
+    // splitmix64 finalizer over the running hash
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+// Two values per mix keeps hashing well below the cost of a build
+uint64_t mixValues(uint64_t hash, const std::vector<int>& values)
+{
+    size_t i = 0;
+    for (; i + 1 < values.size(); i += 2) {
+        hash = mix(hash, (static_cast<uint64_t>(static_cast<uint32_t>(values[i])) << 32)
+                | static_cast<uint32_t>(values[i + 1]));
+    }
+    if (i < values.size()) {
+        hash = mix(hash, static_cast<uint64_t>(values[i]));
+    }
+    return hash;
+}
+
+// Everything the topology is built from when its edges are found from the
+// face vertices
+uint64_t getTopologyState(const std::vector<int>& faceCounts, const std::vector<int>& faceVertices,
+    int numEdges, int numVertices)
+{
+    uint64_t hash = mix(static_cast<uint64_t>(numEdges), static_cast<uint64_t>(numVertices));
+    hash = mixValues(hash, faceCounts);
+    return mixValues(hash, faceVertices);
+}
+
+bool isEdge(const MFnMesh& mesh, int edge, int v0, int v1)
+{
+    int2 vertices;
+    mesh.getEdgeVertices(edge, vertices);
+    return (vertices[0] == v0 && vertices[1] == v1) || (vertices[0] == v1 && vertices[1] == v0);
+}
+
+} // namespace
+
+void getEdgeVertices(const MFnMesh& mesh, std::vector<int>& edgeVertices)
+{
+    int numEdges = mesh.numEdges();
+    edgeVertices.resize(static_cast<size_t>(numEdges) * 2);
+    int2 vertices;
+    for (int i = 0; i < numEdges; i++) {
+        mesh.getEdgeVertices(i, vertices);
+        edgeVertices[static_cast<size_t>(i) * 2] = vertices[0];
+        edgeVertices[static_cast<size_t>(i) * 2 + 1] = vertices[1];
+    }
+}
+
+MeshEdgeLookup::MeshEdgeLookup(const MDagPath& dagPath)
+    : mesh(dagPath)
+    , numEdges(mesh.numEdges())
+    , isPulled(false)
+{
+}
+
+int MeshEdgeLookup::find(int v0, int v1, int guess)
+{
+    if (!isPulled) {
+        if (guess >= 0 && guess < numEdges && isEdge(mesh, guess, v0, v1)) {
+            return guess;
+        }
+        std::vector<int> edgeVertices;
+        getEdgeVertices(mesh, edgeVertices);
+        table.build(std::move(edgeVertices), static_cast<size_t>(mesh.numVertices()));
+        isPulled = true;
+    }
+    return table.find(v0, v1);
+}
+
+TopologyCache& TopologyCache::get()
+{
+    static TopologyCache cache;
+    return cache;
+}
+
+std::shared_ptr<const MeshTopology> TopologyCache::getTopology(const MDagPath& dagPath)
+{
+    MFnMesh mesh(dagPath);
+    MObjectHandle node(dagPath.node());
+
+    MIntArray counts;
+    MIntArray ids;
+    mesh.getVertices(counts, ids);
+    std::vector<int> faceCounts(counts.length());
+    counts.get(faceCounts.data());
+    std::vector<int> faceVertices(ids.length());
+    ids.get(faceVertices.data());
+
+    int numEdges = mesh.numEdges();
+    int numVertices = mesh.numVertices();
+    uint64_t state = getTopologyState(faceCounts, faceVertices, numEdges, numVertices);
+
+    bool hasMeshEdges = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry* entry = findEntry(node);
+        if (entry != nullptr && entry->state == state) {
+            if (!entry->hasMeshEdges) {
+                entry->lastRun = run;
+                return entry->topology;
+            }
+            hasMeshEdges = true;
+        }
+    }
+
+    // Edges pulled from the mesh can be renumbered by edits which keep the
+    // faces, so they are pulled again and compared before the entry is reused
+    std::vector<int> edgeVertices;
+    uint64_t edgeState = 0;
+    if (!hasMeshEdges) {
+        findEdges(faceCounts, faceVertices, static_cast<size_t>(numVertices), edgeVertices);
+        hasMeshEdges = edgeVertices.size() != static_cast<size_t>(numEdges) * 2;
+    }
+    if (hasMeshEdges) {
+        getEdgeVertices(mesh, edgeVertices);
+        edgeState = mixValues(0, edgeVertices);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry* entry = findEntry(node);
+        if (entry != nullptr && entry->state == state && entry->hasMeshEdges && entry->edgeState == edgeState) {
+            entry->lastRun = run;
+            return entry->topology;
+        }
+    }
+
+    std::shared_ptr<MeshTopology> topology = std::make_shared<MeshTopology>();
+    topology->build(faceCounts, std::move(faceVertices), std::move(edgeVertices), static_cast<size_t>(numVertices));
+
+    // Instances of a mesh checked at the same time may have built it twice,
+    // the last one is kept
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* entry = findEntry(node);
+    if (entry == nullptr) {
+        entries[node.hashCode()].push_back({ node, state, hasMeshEdges, edgeState, topology, run });
+    } else {
+        entry->state = state;
+        entry->hasMeshEdges = hasMeshEdges;
+        entry->edgeState = edgeState;
+        entry->topology = topology;
+        entry->lastRun = run;
+    }
+    return topology;
+}
+
+TopologyCache::Entry* TopologyCache::findEntry(const MObjectHandle& node)
+{
+    auto bucket = entries.find(node.hashCode());
+    if (bucket == entries.end()) {
+        return nullptr;
+    }
+    for (Entry& entry : bucket->second) {
+        if (entry.node == node) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void TopologyCache::endRun(size_t maxMemorySize)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::pair<unsigned int, size_t>> lastRuns;
+    size_t memorySize = 0;
+    for (auto bucket = entries.begin(); bucket != entries.end();) {
+        std::vector<Entry>& bucketEntries = bucket->second;
+        bucketEntries.erase(std::remove_if(bucketEntries.begin(), bucketEntries.end(),
+                                [](const Entry& entry) { return !entry.node.isAlive(); }),
+            bucketEntries.end());
+        for (const Entry& entry : bucketEntries) {
+            size_t size = entry.topology->getMemorySize();
+            lastRuns.emplace_back(entry.lastRun, size);
+            memorySize += size;
+        }
+        if (bucketEntries.empty()) {
+            bucket = entries.erase(bucket);
+        } else {
+            ++bucket;
+        }
+    }
+
+    // Oldest runs go first, all entries of a run at once
+    if (memorySize > maxMemorySize) {
+        std::sort(lastRuns.begin(), lastRuns.end());
+        unsigned int oldestKept = 0;
+        size_t i = 0;
+        while (memorySize > maxMemorySize && i < lastRuns.size()) {
+            oldestKept = lastRuns[i].first + 1;
+            for (; i < lastRuns.size() && lastRuns[i].first < oldestKept; i++) {
+                memorySize -= lastRuns[i].second;
+            }
+        }
+        for (auto bucket = entries.begin(); bucket != entries.end();) {
+            std::vector<Entry>& bucketEntries = bucket->second;
+            bucketEntries.erase(std::remove_if(bucketEntries.begin(), bucketEntries.end(),
+                                    [oldestKept](const Entry& entry) { return entry.lastRun < oldestKept; }),
+                bucketEntries.end());
+            if (bucketEntries.empty()) {
+                bucket = entries.erase(bucket);
+            } else {
+                ++bucket;
+            }
+        }
+    }
+    run++;
+}
+
+void TopologyCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+std::vector<std::pair<std::string, size_t>> TopologyCache::getMemoryReport() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<std::string, size_t>> report;
+    for (const auto& bucket : entries) {
+        for (const Entry& entry : bucket.second) {
+            if (!entry.node.isAlive()) {
+                continue;
+            }
+            MFnDagNode dagNode(entry.node.object());
+            report.emplace_back(dagNode.fullPathName().asChar(), entry.topology->getMemorySize());
+        }
+    }
+    std::sort(report.begin(), report.end());
+    return report;
+}
+
+size_t TopologyCache::getMemorySize() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t memorySize = 0;
+    for (const auto& bucket : entries) {
+        for (const Entry& entry : bucket.second) {
+            memorySize += entry.topology->getMemorySize();
+        }
+    }
+    return memorySize;
+}
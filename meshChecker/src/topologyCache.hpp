@@ -0,0 +1,84 @@
+#pragma once
+
+#include "meshTopology.hpp"
+
+#include <maya/MDagPath.h>
+#include <maya/MFnMesh.h>
+#include <maya/MObjectHandle.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Two vertices of each edge of the mesh, one edge after another
+void getEdgeVertices(const MFnMesh& mesh, std::vector<int>& edgeVertices);
+
+// Index in the mesh of edges given by their two vertices. An edge is tried
+// at its index in the topology first, which is its index in meshes numbered
+// as findEdges does. The first miss pulls the edges of the mesh once and
+// lists them by lower vertex, so an edited mesh costs a single pass whatever
+// the number of edges looked up
+class MeshEdgeLookup {
+public:
+    explicit MeshEdgeLookup(const MDagPath& dagPath);
+
+    // Edge from v0 to v1, -1 if the mesh has no such edge
+    int find(int v0, int v1, int guess);
+
+private:
+    MFnMesh mesh;
+    int numEdges;
+    bool isPulled;
+    EdgeTable table;
+};
+
+// Topologies of the meshes checked, by mesh node. Edges are found from the
+// face vertices, so an entry is reused as long as the face vertices and edge
+// count of its mesh are the ones it was built from. Moving vertices keeps it
+// but any topology edit rebuilds it. Meshes whose edge count doesn't match
+// their faces have their edges pulled one by one instead, and those are
+// compared too before the entry is reused. One cache lives for a single
+// command call, and the shared one for as long as the plugin is loaded
+class TopologyCache {
+public:
+    // The cache shared by all calls of the command
+    static TopologyCache& get();
+
+    // Topology of the mesh, built unless cached for the same topology. Safe
+    // to call from several threads
+    std::shared_ptr<const MeshTopology> getTopology(const MDagPath& dagPath);
+
+    // Call once at the end of each command call. Forgets deleted meshes,
+    // then the least recently used ones until the cache holds no more than
+    // maxMemorySize bytes
+    void endRun(size_t maxMemorySize);
+
+    void clear();
+
+    // Path and bytes held of each cached mesh
+    std::vector<std::pair<std::string, size_t>> getMemoryReport() const;
+
+    size_t getMemorySize() const;
+
+private:
+    struct Entry {
+        MObjectHandle node;
+        uint64_t state;
+        // Whether the edges were pulled from the mesh, and their hash
+        bool hasMeshEdges;
+        uint64_t edgeState;
+        std::shared_ptr<const MeshTopology> topology;
+        unsigned int lastRun;
+    };
+
+    // Entries by hash code of their node, which several nodes may share
+    std::unordered_map<unsigned int, std::vector<Entry>> entries;
+    unsigned int run{};
+    mutable std::mutex mutex;
+
+    Entry* findEntry(const MObjectHandle& node);
+};
@@ -4,69 +4,290 @@
 //
 
 #include "bentleyOttmann.hpp"
+#include "lineUtils.hpp"
 #include <algorithm>
-#include <iostream>
-
-BentleyOttmann::BentleyOttmann(std::vector<LineSegment>& edgeVector) : edges(edgeVector)
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <limits>
+
+BentleyOttmann::BentleyOttmann(const SegmentStore& store)
+    : store(store)
+    , slabLeft(-std::numeric_limits<float>::infinity())
+    , slabRight(std::numeric_limits<float>::infinity())
+    , statusTree(StatusComparator(this))
 {
 }
 
 BentleyOttmann::~BentleyOttmann()
 = default;
 
-BentleyOttmann BentleyOttmann::operator+(const BentleyOttmann& rhs) const
+void BentleyOttmann::addSegments(size_t begin, size_t end, EDGE_SET edgeSet)
+{
+    setEdgeSet(edgeSet);
+    edges.reserve(edges.size() + end - begin);
+    for (size_t i = begin; i < end; i++) {
+        addEdge(static_cast<unsigned int>(i), edgeSet);
+    }
+}
+
+void BentleyOttmann::addSegments(size_t begin, size_t end, EDGE_SET edgeSet,
+    float left, float bottom, float right, float top)
+{
+    // Blue edges make this a red/blue check even if none of them are in the
+    // box. Otherwise crossings between red edges would be reported
+    setEdgeSet(edgeSet);
+    for (size_t i = begin; i < end; i++) {
+        // Begin of each edge is always on the left side
+        if (store.x0[i] > right || store.x1[i] < left) {
+            continue;
+        }
+        if (std::min(store.y0[i], store.y1[i]) > top || std::max(store.y0[i], store.y1[i]) < bottom) {
+            continue;
+        }
+        addEdge(static_cast<unsigned int>(i), edgeSet);
+    }
+}
+
+void BentleyOttmann::setEdgeSet(EDGE_SET edgeSet)
+{
+    if (edgeSet == BLUE && !isRedBlue) {
+        // Edges added so far are all red
+        isRedBlue = true;
+        edgeSets.assign(edges.size(), RED);
+    }
+}
+
+void BentleyOttmann::addEdge(unsigned int index, EDGE_SET edgeSet)
+{
+    edges.emplace_back(index);
+    if (isRedBlue) {
+        edgeSets.emplace_back(static_cast<unsigned char>(edgeSet));
+    }
+}
+
+void BentleyOttmann::setSlab(float left, float right)
+{
+    slabLeft = left;
+    slabRight = right;
+}
+
+void BentleyOttmann::getSlabBorders(const SegmentStore& store, size_t begin, size_t end,
+    size_t numSlabs, std::vector<float>& borders)
+{
+    borders.clear();
+    borders.emplace_back(-std::numeric_limits<float>::infinity());
+
+    // Split at quantiles of the left end of the edges
+    std::vector<float> lefts(store.x0.begin() + static_cast<std::ptrdiff_t>(begin),
+        store.x0.begin() + static_cast<std::ptrdiff_t>(end));
+    for (size_t i = 1; i < numSlabs && !lefts.empty(); i++) {
+        auto nth = lefts.begin() + static_cast<std::ptrdiff_t>(lefts.size() * i / numSlabs);
+        std::nth_element(lefts.begin(), nth, lefts.end());
+        if (*nth > borders.back()) {
+            borders.emplace_back(*nth);
+        }
+    }
+    borders.emplace_back(std::numeric_limits<float>::infinity());
+}
+
+void BentleyOttmann::setStopAtFirstCrossing(bool stop)
+{
+    stopAtFirstCrossing = stop;
+}
+
+void BentleyOttmann::setCancelCallback(const std::function<bool()>& callback)
+{
+    isCancelled = callback;
+}
+
+bool BentleyOttmann::StatusComparator::operator()(const StatusEntry& lhs, const StatusEntry& rhs) const
+{
+    return sweep->isBelow(lhs.edge, rhs.edge, sweep->sweepline);
+}
+
+// Vertical edges are at their lower end, where they are inserted. The y
+// values are compared exactly, as rounding them would put an edge which
+// begins on another one on either side of it
+bool BentleyOttmann::isBelow(unsigned int edgeA, unsigned int edgeB, float x) const
 {
-    // Create new BentleyOttmann object
-    size_t newSize = this->edges.size() + rhs.edges.size();
-    std::vector<LineSegment> AB;
-    AB.reserve(newSize);
-    AB.insert(AB.end(), this->edges.begin(), this->edges.end());
-    AB.insert(AB.end(), rhs.edges.begin(), rhs.edges.end());
+    if (edgeA == edgeB) {
+        return false;
+    }
 
-    BentleyOttmann newBO(AB);
+    const SweepEdge& a = sweepEdges[edgeA];
+    const SweepEdge& b = sweepEdges[edgeB];
+    bool isVerticalA = a.x0 == a.x1;
+    bool isVerticalB = b.x0 == b.x1;
+    int order;
+    if (isVerticalA) {
+        order = -getSide(edgeB, x, a.y0);
+    } else if (isVerticalB) {
+        order = getSide(edgeA, x, b.y0);
+    } else {
+        order = lineUtils::compareYAtX(a.x0, a.y0, a.x1, a.y1, b.x0, b.y0, b.x1, b.y1, x);
+    }
+    if (order != 0) {
+        return order < 0;
+    }
 
-    return newBO;
+    // Both edges cross the sweepline at the same point, so order them by
+    // where they go after it. Vertical edges are treated as the steepest ones
+    if (isVerticalA != isVerticalB) {
+        return isVerticalB;
+    }
+    if (!isVerticalA) {
+        int crossSign = lineUtils::getCrossSign(a.x0, a.y0, a.x1, a.y1, b.x0, b.y0, b.x1, b.y1);
+        if (crossSign != 0) {
+            return crossSign > 0;
+        }
+    }
+    if (a.x0 != b.x0) {
+        return a.x0 < b.x0;
+    }
+    if (a.y0 != b.y0) {
+        return a.y0 < b.y0;
+    }
+    return edgeA < edgeB;
 }
 
-void BentleyOttmann::createNewEvent(LineSegment* lineA, LineSegment* lineB)
+// Positive if the edge passes above (x, y) on the sweepline, negative if it
+// passes below and zero if it goes through the point
+int BentleyOttmann::getSide(unsigned int edge, float x, float y) const
+{
+    const SweepEdge& e = sweepEdges[edge];
+    if (e.x0 == e.x1) {
+        return e.y0 > y ? 1 : (e.y0 < y ? -1 : 0);
+    }
+    return -lineUtils::getOrientation(e.x0, e.y0, e.x1, e.y1, x, y);
+}
+
+void BentleyOttmann::checkPair(unsigned int edgeA, unsigned int edgeB)
+{
+    // Two edges can cross only once, so a pair already reported doesn't
+    // need to be tested or scheduled again when they become neighbours again
+    if (crossedPairs.contains(edgeA, edgeB)) {
+        return;
+    }
+
+    if (store.isCrossing(edges[edgeA], edges[edgeB])) {
+        crossedPairs.insert(edgeA, edgeB);
+        // Crossings within a set in red/blue mode, and crossings which belong
+        // to another slab, are not reported. The edges still swap there, so
+        // the event is needed all the same
+        float overlapLeft = std::max(sweepEdges[edgeA].x0, sweepEdges[edgeB].x0);
+        bool isInSlab = overlapLeft >= slabLeft && overlapLeft < slabRight;
+        if (isInSlab && (!isRedBlue || edgeSets[edgeA] != edgeSets[edgeB])) {
+            resultPtr->emplace_back(edges[edgeA]);
+            resultPtr->emplace_back(edges[edgeB]);
+            isStopped = stopAtFirstCrossing;
+        }
+        createNewEvent(edgeA, edgeB);
+    }
+}
+
+void BentleyOttmann::createNewEvent(unsigned int edgeA, unsigned int edgeB)
 {
     float x, y;
-    lineUtils::getIntersectionPoint(*lineA, *lineB, x, y);
-    Point2D p(x, y, 0);
-    Event crossEvent(2, lineA, lineB, p);
-    eventQueue.insert(crossEvent);
+
+    // Collinear edges overlap instead of crossing at a single point and
+    // never swap in the status tree, so there is nothing to schedule. Neither
+    // do vertical edges, which keep their lower end as their place in the
+    // tree and are tested against everything in their range when they begin
+    if (store.isVertical(edges[edgeA]) || store.isVertical(edges[edgeB])) {
+        return;
+    }
+    if (!store.getIntersectionPoint(edges[edgeA], edges[edgeB], x, y)) {
+        return;
+    }
+
+    // x is the float nearest to the crossing, which may be just before it.
+    // doCross moves such events forward until the edges have crossed
+    crossEvents.emplace_back(Event::CROSS, edgeA, edgeB, x, y);
+    std::push_heap(crossEvents.begin(), crossEvents.end(), std::greater<Event>());
 }
 
-void BentleyOttmann::check(std::vector<LineSegment> &result)
+bool BentleyOttmann::nextEvent(Event& ev)
 {
-    resultPtr = &result;
+    bool hasSweepEvent = sweepEventIndex < sweepEvents.size();
+    if (crossEvents.empty()) {
+        if (!hasSweepEvent) {
+            return false;
+        }
+        ev = sweepEvents[sweepEventIndex++];
+        return true;
+    }
 
-    for (auto & edge : edges) {
-        Event ev1(0, &edge, edge.begin);
-        Event ev2(1, &edge, edge.end);
-        eventQueue.insert(ev1);
-        eventQueue.insert(ev2);
+    // Crossings go before the other events at the same x, as in the order of
+    // the events
+    if (hasSweepEvent && !(crossEvents.front() < sweepEvents[sweepEventIndex])) {
+        ev = sweepEvents[sweepEventIndex++];
+        return true;
     }
 
-    statusPtrQueue.reserve(edges.size());
+    std::pop_heap(crossEvents.begin(), crossEvents.end(), std::greater<Event>());
+    ev = crossEvents.back();
+    crossEvents.pop_back();
+    return true;
+}
+
+void BentleyOttmann::check(std::vector<unsigned int> &result)
+{
+    resultPtr = &result;
 
-    while (true) {
-        if (eventQueue.empty()) {
+    statusTree = StatusTree(StatusComparator(this));
+    statusHandles.assign(edges.size(), statusTree.end());
+    crossedPairs.clear();
+    crossedPairs.reserve(edges.size());
+    verticalEdges.clear();
+    isCrossingEdge.assign(edges.size(), 0);
+    crossingRunOf.resize(edges.size());
+
+    auto numEdges = static_cast<unsigned int>(edges.size());
+    sweepEdges.resize(edges.size());
+    sweepEvents.clear();
+    sweepEvents.reserve(edges.size() * 2);
+    for (unsigned int i = 0; i < numEdges; i++) {
+        size_t edge = edges[i];
+        SweepEdge& e = sweepEdges[i];
+        e.x0 = store.x0[edge];
+        e.y0 = store.y0[edge];
+        e.x1 = store.x1[edge];
+        e.y1 = store.y1[edge];
+        sweepEvents.emplace_back(Event::BEGIN, i, e.x0, e.y0);
+        sweepEvents.emplace_back(Event::END, i, e.x1, e.y1);
+    }
+    std::sort(sweepEvents.begin(), sweepEvents.end());
+    sweepEventIndex = 0;
+
+    crossEvents.clear();
+    crossEvents.reserve(edges.size());
+
+    isStopped = false;
+    sweepline = -std::numeric_limits<float>::infinity();
+    float previousSweepline = sweepline;
+    size_t numEvents = 0;
+    Event ev;
+    while (!isStopped && nextEvent(ev)) {
+        if (isCancelled && (++numEvents & 1023) == 0 && isCancelled()) {
             break;
         }
+        // Crossings found late can be behind the sweepline, which never
+        // moves back
+        if (ev.x > sweepline) {
+            previousSweepline = sweepline;
+            sweepline = ev.x;
+        }
 
-        Event firstEvent = *eventQueue.begin();
-        eventQueue.erase(eventQueue.begin());
-
-        switch (firstEvent.eventType) {
+        switch (ev.eventType) {
         case Event::BEGIN:
-            doBegin(firstEvent);
+            doBegin(ev);
             break;
         case Event::END:
-            doEnd(firstEvent);
+            doEnd(ev);
             break;
         case Event::CROSS:
-            doCross(firstEvent);
+            doCross(ev, previousSweepline);
             break;
         default:
             break;
@@ -76,188 +297,257 @@ void BentleyOttmann::check(std::vector<LineSegment> &result)
 
 bool BentleyOttmann::doBegin(Event& ev)
 {
-    LineSegment* currentEdgePtr = ev.edgePtrA;
-    statusPtrQueue.emplace_back(currentEdgePtr);
-
-    if (statusPtrQueue.size() <= 1) {
-        return false;
-    }
-
-    // Set crossing point of Y for all edges in the statusQueue and the sweepline
-    for (auto ePtr : statusPtrQueue) {
-        if (ePtr->isHorizontal) {
-            // If the edge is horizontal, y of corrsing point is always y
-            // as sweepline moves from left to right
-            ePtr->crossingPointY = ePtr->begin.y;
-        } else if (ePtr->isVertical) {
-            // if the edge is vertical, the edge and sweepline are collinear, so
-            // use y of a mid point instread
-            float mid = (ePtr->begin.y + ePtr->end.y) * 0.5F;
-            ePtr->crossingPointY = mid;
-        } else {
-            // otherwise, find y value of crossing point of the edge and sweepline
-            float slope2 = (ePtr->end.y - ePtr->begin.y) / (ePtr->end.x - ePtr->begin.x);
-            float b2 = ePtr->begin.y - slope2 * ePtr->begin.x;
-            float y2 = slope2 * ev.sweepline + b2;
-            ePtr->crossingPointY = y2;
-        }
-    }
-    std::sort(statusPtrQueue.begin(), statusPtrQueue.end(), EdgeCrossingComparator());
-
-    // StatusQueue was sorted so you have to find the edge added to the queue above and find its index
-    auto foundIter = std::find(statusPtrQueue.begin(), statusPtrQueue.end(),
-        currentEdgePtr);
-    if (foundIter == statusPtrQueue.end()) {
-        return false;
-    }
-
-    // Get currentEdge object from the statusQueue after sorted
-    size_t index = static_cast<size_t>(std::distance(statusPtrQueue.begin(), foundIter));
-
-    if (foundIter == statusPtrQueue.begin()) {
-        LineSegment* targetEdge = statusPtrQueue[index + 1];
-        if (*(*foundIter) * *(targetEdge)) {
-            resultPtr->emplace_back(*(*foundIter));
-            resultPtr->emplace_back(*targetEdge);
-            createNewEvent(currentEdgePtr, targetEdge);
+    unsigned int currentEdge = ev.edgeA;
+    StatusEntry entry = { currentEdge };
+    StatusTree::iterator current = statusTree.insert(entry).first;
+    statusHandles[currentEdge] = current;
+
+    // Check the neighbours of the new edge. Edges passing through the event
+    // point (shared vertices, collinear edges) tie with the current edge and
+    // can hide each other, so keep walking while they do. Vertical edges are
+    // keyed by their lower end, so every edge crossing the sweepline within
+    // their y range has to be tested as well. Sides are exact, an edge going
+    // through the point is never taken for one beside it
+    const SweepEdge& e = sweepEdges[currentEdge];
+    bool isVertical = e.x0 == e.x1;
+    float highY = isVertical ? e.y1 : e.y0;
+    for (StatusTree::iterator iter = std::next(current); iter != statusTree.end(); ++iter) {
+        checkPair(currentEdge, iter->edge);
+        if (getSide(iter->edge, e.x0, highY) > 0) {
+            break;
         }
     }
-    else if (foundIter == statusPtrQueue.end() - 1) {
-        LineSegment* targetEdge = statusPtrQueue[index - 1];
-        if (*(*foundIter) * *(targetEdge)) {
-            resultPtr->emplace_back(*(*foundIter));
-            resultPtr->emplace_back(*targetEdge);
-            createNewEvent(currentEdgePtr, targetEdge);
+    for (StatusTree::iterator iter = current; iter != statusTree.begin();) {
+        --iter;
+        checkPair(currentEdge, iter->edge);
+        if (getSide(iter->edge, e.x0, e.y0) < 0) {
+            break;
         }
     }
-    else {
-        LineSegment* nextEdgePtr = statusPtrQueue[index + 1];
-        LineSegment* previousEdgePtr = statusPtrQueue[index - 1];
-        if (*(*foundIter) * *(nextEdgePtr)) {
-            resultPtr->emplace_back(*(*foundIter));
-            resultPtr->emplace_back(*nextEdgePtr);
-            createNewEvent(currentEdgePtr, nextEdgePtr);
+
+    if (isVertical) {
+        // Vertical edges on the same sweepline can overlap each other without
+        // being close in the tree, so test all of them explicitly
+        if (verticalEdges.empty() || sweepEdges[verticalEdges.back()].x0 != sweepline) {
+            verticalEdges.clear();
         }
-        if (*(*foundIter) * *(previousEdgePtr)) {
-            resultPtr->emplace_back(*(*foundIter));
-            resultPtr->emplace_back(*previousEdgePtr);
-            createNewEvent(currentEdgePtr, previousEdgePtr);
+        for (auto vertical : verticalEdges) {
+            if (sweepEdges[vertical].y1 > e.y0) {
+                checkPair(currentEdge, vertical);
+            }
         }
+        verticalEdges.emplace_back(currentEdge);
+
+        // Everything a vertical edge crosses has been tested now, and it has
+        // no place in the order of the tree past the sweepline
+        statusTree.erase(current);
+        statusHandles[currentEdge] = statusTree.end();
     }
     return true;
 }
 
 bool BentleyOttmann::doEnd(Event& ev)
 {
-    LineSegment* currentEdgePtr = ev.edgePtrA;
-    auto foundIter = std::find(statusPtrQueue.begin(), statusPtrQueue.end(), currentEdgePtr);
-
-    if (foundIter == statusPtrQueue.end()) {
-        // if iter not found
-        std::cout << "Not found" << std::endl;
+    // Vertical edges are removed right after they begin
+    if (sweepEdges[ev.edgeA].x0 == sweepEdges[ev.edgeA].x1) {
         return false;
     }
 
-    if (foundIter == statusPtrQueue.begin() || foundIter == statusPtrQueue.end() - 1) {
-
+    // Every other edge stays in the tree from its begin to its end. This runs
+    // in a plugin, so a broken sweep skips the edge instead of writing to
+    // the console
+    StatusTree::iterator current = statusHandles[ev.edgeA];
+    assert(current != statusTree.end());
+    if (current == statusTree.end()) {
+        return false;
     }
-    else {
-        size_t index = static_cast<size_t>(std::distance(statusPtrQueue.begin(), foundIter));
-        LineSegment* nextEdgePtr = statusPtrQueue[index + 1];
-        LineSegment* previousEdgePtr = statusPtrQueue[index - 1];
-        bool isCrossing = (*nextEdgePtr) * (*previousEdgePtr);
-        if (isCrossing) {
-            resultPtr->emplace_back(*previousEdgePtr);
-            resultPtr->emplace_back(*nextEdgePtr);
-            createNewEvent(nextEdgePtr, previousEdgePtr);
-        }
+
+    StatusTree::iterator next = std::next(current);
+    if (current != statusTree.begin() && next != statusTree.end()) {
+        checkPair(std::prev(current)->edge, next->edge);
     }
 
-    // Remove current edge from the statusQueue
-    statusPtrQueue.erase(foundIter);
+    // Remove current edge from the status tree
+    statusTree.erase(current);
+    statusHandles[ev.edgeA] = statusTree.end();
 
     return true;
 }
 
-bool BentleyOttmann::doCross(Event& ev)
+bool BentleyOttmann::isSteeper(unsigned int edgeA, unsigned int edgeB) const
 {
-    if (statusPtrQueue.size() <= 2) {
-        return false;
-    }
+    const SweepEdge& a = sweepEdges[edgeA];
+    const SweepEdge& b = sweepEdges[edgeB];
+    return lineUtils::getCrossSign(a.x0, a.y0, a.x1, a.y1, b.x0, b.y0, b.x1, b.y1) < 0;
+}
 
-    LineSegment* edgePtr = ev.edgePtrA;
-    LineSegment* otherEdgePtr = ev.edgePtrB;
+void BentleyOttmann::addCrossing(Event& ev)
+{
+    if (statusHandles[ev.edgeA] == statusTree.end() || statusHandles[ev.edgeB] == statusTree.end()) {
+        return;
+    }
 
-    auto lineAPtrIter = std::find(statusPtrQueue.begin(), statusPtrQueue.end(),
-        edgePtr);
-    auto lineBPtrIter = std::find(statusPtrQueue.begin(), statusPtrQueue.end(),
-        otherEdgePtr);
-    if (lineAPtrIter == statusPtrQueue.end() || lineBPtrIter == statusPtrQueue.end()) {
-        return false;
+    // Before the crossing point the steeper edge is the lower one. The event
+    // point is rounded, and if the edges are still in that order at the
+    // sweepline, the crossing is right after it
+    unsigned int lower = ev.edgeA;
+    unsigned int upper = ev.edgeB;
+    if (!isSteeper(lower, upper)) {
+        std::swap(lower, upper);
+    }
+    if (!isBelow(upper, lower, sweepline)) {
+        ev.x = std::nextafter(sweepline, std::numeric_limits<float>::infinity());
+        crossEvents.emplace_back(ev);
+        std::push_heap(crossEvents.begin(), crossEvents.end(), std::greater<Event>());
+        return;
     }
 
-    size_t lineAIndex = static_cast<size_t>(std::distance(statusPtrQueue.begin(), lineAPtrIter));
-    size_t lineBIndex = static_cast<size_t>(std::distance(statusPtrQueue.begin(), lineBPtrIter));
-    size_t small, big;
+    addCrossingEdge(lower);
+    addCrossingEdge(upper);
+}
 
-    if (lineAIndex > lineBIndex) {
-        small = lineBIndex;
-        big = lineAIndex;
+// Collinear edges overlapping the edge are next to it in the tree and cross
+// the same edges at the same points, but their crossings are only found once
+// they move with it
+void BentleyOttmann::addCrossingEdge(unsigned int edge)
+{
+    if (isCrossingEdge[edge] != 0) {
+        return;
+    }
+    isCrossingEdge[edge] = 1;
+    crossingEdges.emplace_back(edge);
+
+    StatusTree::iterator current = statusHandles[edge];
+    for (StatusTree::iterator iter = std::next(current); iter != statusTree.end() && isCollinear(edge, iter->edge); ++iter) {
+        if (isCrossingEdge[iter->edge] == 0) {
+            isCrossingEdge[iter->edge] = 1;
+            crossingEdges.emplace_back(iter->edge);
+        }
     }
-    else {
-        small = lineAIndex;
-        big = lineBIndex;
+    for (StatusTree::iterator iter = current; iter != statusTree.begin() && isCollinear(edge, std::prev(iter)->edge);) {
+        --iter;
+        if (isCrossingEdge[iter->edge] == 0) {
+            isCrossingEdge[iter->edge] = 1;
+            crossingEdges.emplace_back(iter->edge);
+        }
     }
+}
+
+bool BentleyOttmann::isCollinear(unsigned int edgeA, unsigned int edgeB) const
+{
+    const SweepEdge& a = sweepEdges[edgeA];
+    const SweepEdge& b = sweepEdges[edgeB];
+    return lineUtils::getOrientation(a.x0, a.y0, a.x1, a.y1, b.x0, b.y0) == 0
+        && lineUtils::getOrientation(a.x0, a.y0, a.x1, a.y1, b.x1, b.y1) == 0;
+}
 
-    if (small == 0) {
-        // Check the first edge and the one after next edge
+bool BentleyOttmann::doCross(Event& ev, float previousSweepline)
+{
+    // All crossings at the sweepline are done at once. Crossings a float
+    // apart, or of three or more edges at a same point, change the order of
+    // edges which aren't neighbours
+    crossingEdges.clear();
+    addCrossing(ev);
+    while (!crossEvents.empty() && crossEvents.front().x <= sweepline) {
+        std::pop_heap(crossEvents.begin(), crossEvents.end(), std::greater<Event>());
+        Event crossing = crossEvents.back();
+        crossEvents.pop_back();
+        addCrossing(crossing);
+    }
+    if (crossingEdges.empty()) {
+        return false;
+    }
 
-        // If If the second edge is the last element of the statusQueue, then there is
-        // no edge to be checked with the first edge
-        if (statusPtrQueue.size() == static_cast<size_t>(big) + 1) {
-            return false;
+    // Edges ending on the sweepline can end where the crossing edges meet,
+    // on the far side of some of them. They are inserted again as well, so
+    // that the whole tree is in order at the sweepline
+    for (size_t i = sweepEventIndex; i < sweepEvents.size() && sweepEvents[i].x == sweepline; i++) {
+        if (sweepEvents[i].eventType == Event::END && statusHandles[sweepEvents[i].edgeA] != statusTree.end()) {
+            addCrossingEdge(sweepEvents[i].edgeA);
         }
+    }
 
-        LineSegment* lineAPtr = statusPtrQueue[small];
-        LineSegment* lineBPtr = statusPtrQueue[big + 1];
-        bool isCrossing = (*lineAPtr) * (*lineBPtr);
-        if (isCrossing) {
-            resultPtr->emplace_back(*lineAPtr);
-            resultPtr->emplace_back(*lineBPtr);
-            createNewEvent(lineAPtr, lineBPtr);
+    // The other edges of the tree are in the same order as at the previous
+    // event, so inserting these again puts them where they are after the
+    // crossings. Edges they were between become neighbours
+    for (unsigned int edge : crossingEdges) {
+        StatusTree::iterator current = statusHandles[edge];
+        StatusTree::iterator next = std::next(current);
+        if (current != statusTree.begin() && next != statusTree.end()) {
+            unsigned int prevEdge = std::prev(current)->edge;
+            if (isCrossingEdge[prevEdge] == 0 && isCrossingEdge[next->edge] == 0) {
+                checkPair(prevEdge, next->edge);
+            }
         }
+        statusTree.erase(current);
+    }
+    for (unsigned int edge : crossingEdges) {
+        StatusEntry entry = { edge };
+        statusHandles[edge] = statusTree.insert(entry).first;
     }
-    else if (big == statusPtrQueue.size() - 1) {
-        // Check the last edge and the one before the previous edge
 
-        LineSegment* lineAPtr = statusPtrQueue[small - 1];
-        LineSegment* lineBPtr = statusPtrQueue[big];
-        bool isCrossing = (*lineAPtr) * (*lineBPtr);
-        if (isCrossing) {
-            resultPtr->emplace_back(*lineAPtr);
-            resultPtr->emplace_back(*lineBPtr);
-            createNewEvent(lineAPtr, lineBPtr);
+    // Moved edges in tree order, and the runs of those next to each other
+    // in the tree, as their lowest edge and the position past their highest
+    // one. Edges next to each other in a run are new neighbours
+    std::sort(crossingEdges.begin(), crossingEdges.end(),
+        [this](unsigned int a, unsigned int b) { return isBelow(a, b, sweepline); });
+    crossingRuns.clear();
+    for (size_t i = 0; i < crossingEdges.size(); i++) {
+        StatusTree::iterator current = statusHandles[crossingEdges[i]];
+        if (i == 0 || std::next(statusHandles[crossingEdges[i - 1]]) != current) {
+            crossingRuns.emplace_back(current, current);
+        } else {
+            checkPair(crossingEdges[i - 1], crossingEdges[i]);
         }
+        ++crossingRuns.back().second;
+        crossingRunOf[crossingEdges[i]] = static_cast<unsigned int>(crossingRuns.size() - 1);
     }
-    else {
-        // Check the first edge and the one after next(third)
-        LineSegment* lineAPtr = statusPtrQueue[small - 1];
-        LineSegment* lineBPtr = statusPtrQueue[big];
-        bool isCrossing = (*lineAPtr) * (*lineBPtr);
-        if (isCrossing) {
-            resultPtr->emplace_back(*lineAPtr);
-            resultPtr->emplace_back(*lineBPtr);
-            createNewEvent(lineAPtr, lineBPtr);
+
+    // Every edge an edge moved past has crossed it. The others are next to
+    // it on the side it came from, up to the first of them which was already
+    // there at the previous event, as they all kept their order. This tests
+    // the new neighbours as well. Runs of moved edges are jumped over whole,
+    // so that a walk costs as much as the edges it tests
+    for (unsigned int edge : crossingEdges) {
+        StatusTree::iterator iter = crossingRuns[crossingRunOf[edge]].second;
+        while (iter != statusTree.end()) {
+            if (isCrossingEdge[iter->edge] != 0) {
+                iter = crossingRuns[crossingRunOf[iter->edge]].second;
+                continue;
+            }
+            checkPair(edge, iter->edge);
+            if (isBelow(edge, iter->edge, previousSweepline)) {
+                break;
+            }
+            ++iter;
         }
-        // Check the second edge and the one after next(forth)
-        LineSegment* lineCPtr = statusPtrQueue[small];
-        LineSegment* lineDPtr = statusPtrQueue[big + 1];
-        isCrossing = (*lineCPtr) * (*lineDPtr);
-        if (isCrossing) {
-            resultPtr->emplace_back(*lineCPtr);
-            resultPtr->emplace_back(*lineDPtr);
-            createNewEvent(lineCPtr, lineDPtr);
+        iter = crossingRuns[crossingRunOf[edge]].first;
+        while (iter != statusTree.begin()) {
+            --iter;
+            if (isCrossingEdge[iter->edge] != 0) {
+                iter = crossingRuns[crossingRunOf[iter->edge]].first;
+                continue;
+            }
+            checkPair(iter->edge, edge);
+            if (isBelow(iter->edge, edge, previousSweepline)) {
+                break;
+            }
         }
     }
-    return false;
+
+    // Two moved edges have crossed if their order changed since the previous
+    // event, which catches pairs of a bundle that were never neighbours.
+    // Sorting them from their order at the sweepline back to their order
+    // there swaps exactly those pairs, so many crossings at one sweepline
+    // cost as much as the pairs which cross, not every pair of moved edges
+    for (size_t i = 1; i < crossingEdges.size(); i++) {
+        for (size_t j = i; j > 0 && isBelow(crossingEdges[j], crossingEdges[j - 1], previousSweepline); j--) {
+            checkPair(crossingEdges[j - 1], crossingEdges[j]);
+            std::swap(crossingEdges[j - 1], crossingEdges[j]);
+        }
+    }
+    for (unsigned int edge : crossingEdges) {
+        isCrossingEdge[edge] = 0;
+    }
+    return true;
 }
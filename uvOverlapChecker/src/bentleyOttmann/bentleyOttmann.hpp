@@ -6,29 +6,134 @@
 #pragma once
 
 #include "event.hpp"
-#include "lineSegment.hpp"
+#include "pairSet.hpp"
+#include "segmentStore.hpp"
 
+#include <functional>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 class BentleyOttmann {
 public:
-    explicit BentleyOttmann(std::vector<LineSegment>& edgeVector);
+    explicit BentleyOttmann(const SegmentStore& store);
     ~BentleyOttmann();
 
-    void check(std::vector<LineSegment> &result);
-    std::vector<LineSegment> edges;
+    // Edges of a check are all red unless some blue ones are added. In that
+    // case only crossings between a red and a blue edge are reported
+    enum EDGE_SET {
+        RED,
+        BLUE
+    };
 
-    BentleyOttmann operator+(const BentleyOttmann& rhs) const;
+    // Add edges [begin, end) of the store to the check
+    void addSegments(size_t begin, size_t end, EDGE_SET edgeSet = RED);
+
+    // Add the edges of [begin, end) which touch the given box. Use it with the
+    // overlap of the bounding boxes of two sets, the only place where edges of
+    // different sets can cross
+    void addSegments(size_t begin, size_t end, EDGE_SET edgeSet,
+        float left, float bottom, float right, float top);
+
+    // Only report crossings of edge pairs whose x ranges start to overlap in
+    // [left, right). Checking the edges touching each slab of a shell with
+    // this reports every crossing of the shell exactly once
+    void setSlab(float left, float right);
+
+    // Stop the check as soon as one crossing has been reported
+    void setStopAtFirstCrossing(bool stop);
+
+    // Called every now and then during the check, which stops once it
+    // returns true. Lets other threads cancel checks they no longer need
+    void setCancelCallback(const std::function<bool()>& callback);
+
+    // Fill result with store indices of crossing edges, two per crossing
+    void check(std::vector<unsigned int> &result);
+
+    // Borders of numSlabs slabs along x with about as many edges of
+    // [begin, end) each. Slab i is [borders[i], borders[i + 1]), the first and
+    // last borders are -inf and +inf. Fewer slabs come out if edges pile up
+    static void getSlabBorders(const SegmentStore& store, size_t begin, size_t end,
+        size_t numSlabs, std::vector<float>& borders);
 
 private:
-    std::vector<LineSegment> *resultPtr{};
+    // Tree node payload
+    struct StatusEntry {
+        unsigned int edge;
+    };
+
+    // Orders edges by the y value where they cross the current sweepline,
+    // exactly, so that an edge beginning on another one is never put on the
+    // wrong side of it
+    class StatusComparator {
+    public:
+        explicit StatusComparator(const BentleyOttmann* sweep) : sweep(sweep) {}
+        bool operator()(const StatusEntry& lhs, const StatusEntry& rhs) const;
+    private:
+        const BentleyOttmann* sweep;
+    };
+
+    typedef std::set<StatusEntry, StatusComparator> StatusTree;
+
+    // End points of an edge, gathered from the store when the sweep starts so
+    // that the comparator touches a single cache line per edge
+    struct SweepEdge {
+        float x0, y0, x1, y1;
+    };
+
+    const SegmentStore& store;
+    // Store index of each edge of the sweep. Everything else in the sweep
+    // refers to edges by their position in this vector
+    std::vector<unsigned int> edges;
+    std::vector<SweepEdge> sweepEdges;
+    // Set of each edge, only filled once a blue edge has been added
+    std::vector<unsigned char> edgeSets;
+    bool isRedBlue{};
+
+    float slabLeft;
+    float slabRight;
+    bool stopAtFirstCrossing{};
+    bool isStopped{};
+    std::function<bool()> isCancelled;
+
+    std::vector<unsigned int> *resultPtr{};
+    void setEdgeSet(EDGE_SET edgeSet);
+    void addEdge(unsigned int index, EDGE_SET edgeSet);
+    bool nextEvent(Event& ev);
     bool doBegin(Event& ev);
     bool doEnd(Event& ev);
-    bool doCross(Event& ev);
-    void createNewEvent(LineSegment* lineA, LineSegment* lineB);
+    bool doCross(Event& ev, float previousSweepline);
+    void addCrossing(Event& ev);
+    void addCrossingEdge(unsigned int edge);
+    bool isCollinear(unsigned int edgeA, unsigned int edgeB) const;
+    bool isSteeper(unsigned int edgeA, unsigned int edgeB) const;
+    void checkPair(unsigned int edgeA, unsigned int edgeB);
+    void createNewEvent(unsigned int edgeA, unsigned int edgeB);
+    bool isBelow(unsigned int edgeA, unsigned int edgeB, float x) const;
+    int getSide(unsigned int edge, float x, float y) const;
+
+    float sweepline{};
+    StatusTree statusTree;
+    // Position of each edge in the status tree
+    std::vector<StatusTree::iterator> statusHandles;
+    PairSet crossedPairs;
+    // Vertical edges that begin on the current sweepline
+    std::vector<unsigned int> verticalEdges;
+    // Edges of the crossings at the current sweepline, re-inserted together,
+    // and a flag per edge telling if it is one of them
+    std::vector<unsigned int> crossingEdges;
+    std::vector<unsigned char> isCrossingEdge;
+    // Runs of crossing edges next to each other in the tree once they are
+    // re-inserted, from their lowest edge to past their highest one, and the
+    // run of each crossing edge
+    std::vector<std::pair<StatusTree::iterator, StatusTree::iterator> > crossingRuns;
+    std::vector<unsigned int> crossingRunOf;
 
-    std::vector<LineSegment*> statusPtrQueue;
-    std::multiset<Event> eventQueue;
+    // BEGIN/END events are known up front and sorted once. CROSS events are
+    // found during the sweep and kept in a binary min-heap. Both buffers keep
+    // their memory, so the sweep loop itself doesn't allocate
+    std::vector<Event> sweepEvents;
+    size_t sweepEventIndex{};
+    std::vector<Event> crossEvents;
 };
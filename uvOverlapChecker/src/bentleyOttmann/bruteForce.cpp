@@ -0,0 +1,70 @@
+//
+//  bruteForce.cpp
+//  bentleyOttmann
+//
+
+#include "bruteForce.hpp"
+#include "crossingKernel.hpp"
+
+#include <cstdint>
+
+namespace {
+
+// Test the edge at index against [begin, end) and add crossings to the result
+void checkEdge(const SegmentStore& store, size_t index, size_t begin, size_t end,
+    std::vector<uint32_t>& masks, std::vector<unsigned int>& result)
+{
+    if (begin >= end) {
+        return;
+    }
+    store.findCrossings(index, begin, end, masks.data());
+
+    size_t numWords = crossingKernel::getMaskSize(end - begin);
+    for (size_t word = 0; word < numWords; word++) {
+        uint32_t mask = masks[word];
+        for (unsigned int bit = 0; mask != 0; bit++, mask >>= 1) {
+            if ((mask & 1U) != 0) {
+                result.emplace_back(static_cast<unsigned int>(index));
+                result.emplace_back(static_cast<unsigned int>(begin + word * 32 + bit));
+            }
+        }
+    }
+}
+
+} // namespace
+
+namespace bruteForce {
+
+size_t getDefaultThreshold()
+{
+    // About half of the measured crossover points on jittered quad shells,
+    // the sweep degrades more gracefully when shells get crowded
+    switch (crossingKernel::getInstructionSet()) {
+    case crossingKernel::AVX512:
+        return 512;
+    case crossingKernel::AVX2:
+        return 256;
+    case crossingKernel::SSE42:
+        return 128;
+    default:
+        return 48;
+    }
+}
+
+void check(const SegmentStore& store, size_t begin, size_t end, std::vector<unsigned int>& result)
+{
+    std::vector<uint32_t> masks(crossingKernel::getMaskSize(end - begin));
+    for (size_t i = begin; i < end; i++) {
+        checkEdge(store, i, i + 1, end, masks, result);
+    }
+}
+
+void check(const SegmentStore& store, size_t beginA, size_t endA, size_t beginB, size_t endB,
+    std::vector<unsigned int>& result)
+{
+    std::vector<uint32_t> masks(crossingKernel::getMaskSize(endB - beginB));
+    for (size_t i = beginA; i < endA; i++) {
+        checkEdge(store, i, beginB, endB, masks, result);
+    }
+}
+}
@@ -0,0 +1,30 @@
+//
+//  bruteForce.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include "segmentStore.hpp"
+
+#include <vector>
+
+// Tests every pair of edges with the crossing kernel. Small shells fit in the
+// cache, and for them this is faster than setting up a sweep. Results are in
+// the same format as BentleyOttmann::check, store indices of crossing edges,
+// two per crossing
+namespace bruteForce {
+
+// Number of edges under which checking every pair is faster than the sweep.
+// It depends on how many candidates the crossing kernel tests at once, see
+// "main crossover" for the measurement
+size_t getDefaultThreshold();
+
+// Crossings between edges of [begin, end)
+void check(const SegmentStore& store, size_t begin, size_t end, std::vector<unsigned int>& result);
+
+// Crossings between an edge of [beginA, endA) and an edge of [beginB, endB).
+// Crossings within each range are not tested
+void check(const SegmentStore& store, size_t beginA, size_t endA, size_t beginB, size_t endB,
+    std::vector<unsigned int>& result);
+}
@@ -0,0 +1,465 @@
+//
+//  crossingKernel.cpp
+//  bentleyOttmann
+//
+//  This file has to be compiled without floating point contraction
+//  (-ffp-contract=off), otherwise the compiler may fuse the orientation
+//  multiplications and subtractions into FMA instructions, which the error
+//  bound of the float path doesn't account for
+//
+
+#include "crossingKernel.hpp"
+#include "lineUtils.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CROSSING_KERNEL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+
+typedef void (*KernelFunc)(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks);
+
+void setBit(uint32_t* masks, size_t index)
+{
+    masks[index >> 5] |= 1U << (index & 31);
+}
+
+void findCrossingsScalarRange(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t begin, size_t end, uint32_t* masks)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (lineUtils::isCrossing(ax0, ay0, ax1, ay1, bx0[i], by0[i], bx1[i], by1[i])) {
+            setBit(masks, i);
+        }
+    }
+}
+
+void findCrossingsScalar(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks)
+{
+    findCrossingsScalarRange(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, 0, count, masks);
+}
+
+// Merge the result of a block starting at index into the masks. Lanes where
+// the sign of an orientation is not certain in float, or where the edges are
+// collinear, are rare. Those go through the scalar test which handles the
+// overlap rule and falls back to exact arithmetic
+void storeBlock(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t index, unsigned int crossing, unsigned int uncertain, uint32_t* masks)
+{
+    // Blocks never straddle two mask words as the block sizes divide 32
+    masks[index >> 5] |= static_cast<uint32_t>(crossing) << (index & 31);
+
+    for (unsigned int lane = 0; uncertain != 0; lane++, uncertain >>= 1) {
+        if ((uncertain & 1U) == 0) {
+            continue;
+        }
+        size_t i = index + lane;
+        if (lineUtils::isCrossing(ax0, ay0, ax1, ay1, bx0[i], by0[i], bx1[i], by1[i])) {
+            setBit(masks, i);
+        }
+    }
+}
+
+#ifdef CROSSING_KERNEL_X86
+
+// Each lane computes the four orientations of lineUtils::isCrossing like the
+// float path of lineUtils::getCrossSign, left - right with its error bound:
+//   o1 = cross(A1 - A0, B0 - A0), o2 = cross(A1 - A0, B1 - A0)
+//   o3 = cross(B1 - B0, A0 - B0), o4 = cross(B1 - B0, A1 - B0)
+// Lanes where all four are larger than their bound cross if o1, o2 and o3, o4
+// have opposite signs. Blocks with other lanes look for zero orientations,
+// where a factor of each product is zero or the point is the other end of
+// the line, as for shared end points. Those are certain and don't cross.
+// Lanes still uncertain, or with four zero orientations, go through the
+// scalar test
+
+// Sign bits of the orientation dx0 * dy1 - dy0 * dx1 of each lane, and
+// the lanes where the sign is certain
+KERNEL_TARGET("sse4.2")
+void getOrientationSSE42(__m128 dx0, __m128 dy1, __m128 dy0, __m128 dx1,
+    unsigned int& negative, unsigned int& certain)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 errorBound = _mm_set1_ps(lineUtils::orientationErrorBound);
+    __m128 left = _mm_mul_ps(dx0, dy1);
+    __m128 right = _mm_mul_ps(dy0, dx1);
+    __m128 det = _mm_sub_ps(left, right);
+    __m128 bound = _mm_mul_ps(errorBound, _mm_add_ps(_mm_and_ps(left, absMask), _mm_and_ps(right, absMask)));
+    negative = static_cast<unsigned int>(_mm_movemask_ps(det));
+    certain = static_cast<unsigned int>(_mm_movemask_ps(_mm_cmpgt_ps(_mm_and_ps(det, absMask), bound)));
+}
+
+// Lanes where a factor of both products of the orientation is zero
+KERNEL_TARGET("sse4.2")
+unsigned int getZeroFactorsSSE42(__m128 dx0, __m128 dy1, __m128 dy0, __m128 dx1)
+{
+    const __m128 zero = _mm_setzero_ps();
+    return static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(_mm_or_ps(_mm_cmpeq_ps(dx0, zero), _mm_cmpeq_ps(dy1, zero)), _mm_or_ps(_mm_cmpeq_ps(dy0, zero), _mm_cmpeq_ps(dx1, zero)))));
+}
+
+// Lanes where point 0 and point 1 are the same
+KERNEL_TARGET("sse4.2")
+unsigned int getEqualPointsSSE42(__m128 x0, __m128 y0, __m128 x1, __m128 y1)
+{
+    return static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(_mm_cmpeq_ps(x0, x1), _mm_cmpeq_ps(y0, y1))));
+}
+
+KERNEL_TARGET("sse4.2")
+void findCrossingsSSE42(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks)
+{
+    const __m128 vax0 = _mm_set1_ps(ax0);
+    const __m128 vay0 = _mm_set1_ps(ay0);
+    const __m128 vax1 = _mm_set1_ps(ax1);
+    const __m128 vay1 = _mm_set1_ps(ay1);
+    const __m128 dxA = _mm_set1_ps(ax1 - ax0);
+    const __m128 dyA = _mm_set1_ps(ay1 - ay0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vbx0 = _mm_loadu_ps(bx0 + i);
+        __m128 vby0 = _mm_loadu_ps(by0 + i);
+        __m128 vbx1 = _mm_loadu_ps(bx1 + i);
+        __m128 vby1 = _mm_loadu_ps(by1 + i);
+        __m128 dxB = _mm_sub_ps(vbx1, vbx0);
+        __m128 dyB = _mm_sub_ps(vby1, vby0);
+        __m128 dx1 = _mm_sub_ps(vbx0, vax0);
+        __m128 dy1 = _mm_sub_ps(vby0, vay0);
+        __m128 dx2 = _mm_sub_ps(vbx1, vax0);
+        __m128 dy2 = _mm_sub_ps(vby1, vay0);
+        __m128 dx3 = _mm_sub_ps(vax0, vbx0);
+        __m128 dy3 = _mm_sub_ps(vay0, vby0);
+        __m128 dx4 = _mm_sub_ps(vax1, vbx0);
+        __m128 dy4 = _mm_sub_ps(vay1, vby0);
+
+        unsigned int negative1, negative2, negative3, negative4;
+        unsigned int certain1, certain2, certain3, certain4;
+        getOrientationSSE42(dxA, dy1, dyA, dx1, negative1, certain1);
+        getOrientationSSE42(dxA, dy2, dyA, dx2, negative2, certain2);
+        getOrientationSSE42(dxB, dy3, dyB, dx3, negative3, certain3);
+        getOrientationSSE42(dxB, dy4, dyB, dx4, negative4, certain4);
+        unsigned int certain = certain1 & certain2 & certain3 & certain4;
+        unsigned int crossing = certain & (negative1 ^ negative2) & (negative3 ^ negative4);
+        unsigned int uncertain = ~certain & 0xFU;
+        if (uncertain != 0) {
+            unsigned int isB1OnA1 = getEqualPointsSSE42(vbx1, vby1, vax1, vay1);
+            unsigned int zero1 = getZeroFactorsSSE42(dxA, dy1, dyA, dx1) | getEqualPointsSSE42(vbx0, vby0, vax1, vay1);
+            unsigned int zero2 = getZeroFactorsSSE42(dxA, dy2, dyA, dx2) | isB1OnA1;
+            unsigned int zero3 = getZeroFactorsSSE42(dxB, dy3, dyB, dx3) | getEqualPointsSSE42(vbx1, vby1, vax0, vay0);
+            unsigned int zero4 = getZeroFactorsSSE42(dxB, dy4, dyB, dx4) | isB1OnA1;
+            certain = (certain1 | zero1) & (certain2 | zero2) & (certain3 | zero3) & (certain4 | zero4);
+            crossing = certain & ~(zero1 | zero2 | zero3 | zero4) & (negative1 ^ negative2) & (negative3 ^ negative4);
+            uncertain = (~certain | (zero1 & zero2 & zero3 & zero4)) & 0xFU;
+        }
+        storeBlock(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1,
+            i, crossing, uncertain, masks);
+    }
+    findCrossingsScalarRange(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, i, count, masks);
+}
+
+KERNEL_TARGET("avx2")
+void getOrientationAVX2(__m256 dx0, __m256 dy1, __m256 dy0, __m256 dx1,
+    unsigned int& negative, unsigned int& certain)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 errorBound = _mm256_set1_ps(lineUtils::orientationErrorBound);
+    __m256 left = _mm256_mul_ps(dx0, dy1);
+    __m256 right = _mm256_mul_ps(dy0, dx1);
+    __m256 det = _mm256_sub_ps(left, right);
+    __m256 bound = _mm256_mul_ps(errorBound, _mm256_add_ps(_mm256_and_ps(left, absMask), _mm256_and_ps(right, absMask)));
+    negative = static_cast<unsigned int>(_mm256_movemask_ps(det));
+    certain = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_and_ps(det, absMask), bound, _CMP_GT_OQ)));
+}
+
+KERNEL_TARGET("avx2")
+unsigned int getZeroFactorsAVX2(__m256 dx0, __m256 dy1, __m256 dy0, __m256 dx1)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(_mm256_or_ps(_mm256_cmp_ps(dx0, zero, _CMP_EQ_OQ), _mm256_cmp_ps(dy1, zero, _CMP_EQ_OQ)), _mm256_or_ps(_mm256_cmp_ps(dy0, zero, _CMP_EQ_OQ), _mm256_cmp_ps(dx1, zero, _CMP_EQ_OQ)))));
+}
+
+KERNEL_TARGET("avx2")
+unsigned int getEqualPointsAVX2(__m256 x0, __m256 y0, __m256 x1, __m256 y1)
+{
+    return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(x0, x1, _CMP_EQ_OQ), _mm256_cmp_ps(y0, y1, _CMP_EQ_OQ))));
+}
+
+KERNEL_TARGET("avx2")
+void findCrossingsAVX2(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks)
+{
+    const __m256 vax0 = _mm256_set1_ps(ax0);
+    const __m256 vay0 = _mm256_set1_ps(ay0);
+    const __m256 vax1 = _mm256_set1_ps(ax1);
+    const __m256 vay1 = _mm256_set1_ps(ay1);
+    const __m256 dxA = _mm256_set1_ps(ax1 - ax0);
+    const __m256 dyA = _mm256_set1_ps(ay1 - ay0);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vbx0 = _mm256_loadu_ps(bx0 + i);
+        __m256 vby0 = _mm256_loadu_ps(by0 + i);
+        __m256 vbx1 = _mm256_loadu_ps(bx1 + i);
+        __m256 vby1 = _mm256_loadu_ps(by1 + i);
+        __m256 dxB = _mm256_sub_ps(vbx1, vbx0);
+        __m256 dyB = _mm256_sub_ps(vby1, vby0);
+        __m256 dx1 = _mm256_sub_ps(vbx0, vax0);
+        __m256 dy1 = _mm256_sub_ps(vby0, vay0);
+        __m256 dx2 = _mm256_sub_ps(vbx1, vax0);
+        __m256 dy2 = _mm256_sub_ps(vby1, vay0);
+        __m256 dx3 = _mm256_sub_ps(vax0, vbx0);
+        __m256 dy3 = _mm256_sub_ps(vay0, vby0);
+        __m256 dx4 = _mm256_sub_ps(vax1, vbx0);
+        __m256 dy4 = _mm256_sub_ps(vay1, vby0);
+
+        unsigned int negative1, negative2, negative3, negative4;
+        unsigned int certain1, certain2, certain3, certain4;
+        getOrientationAVX2(dxA, dy1, dyA, dx1, negative1, certain1);
+        getOrientationAVX2(dxA, dy2, dyA, dx2, negative2, certain2);
+        getOrientationAVX2(dxB, dy3, dyB, dx3, negative3, certain3);
+        getOrientationAVX2(dxB, dy4, dyB, dx4, negative4, certain4);
+        unsigned int certain = certain1 & certain2 & certain3 & certain4;
+        unsigned int crossing = certain & (negative1 ^ negative2) & (negative3 ^ negative4);
+        unsigned int uncertain = ~certain & 0xFFU;
+        if (uncertain != 0) {
+            unsigned int isB1OnA1 = getEqualPointsAVX2(vbx1, vby1, vax1, vay1);
+            unsigned int zero1 = getZeroFactorsAVX2(dxA, dy1, dyA, dx1) | getEqualPointsAVX2(vbx0, vby0, vax1, vay1);
+            unsigned int zero2 = getZeroFactorsAVX2(dxA, dy2, dyA, dx2) | isB1OnA1;
+            unsigned int zero3 = getZeroFactorsAVX2(dxB, dy3, dyB, dx3) | getEqualPointsAVX2(vbx1, vby1, vax0, vay0);
+            unsigned int zero4 = getZeroFactorsAVX2(dxB, dy4, dyB, dx4) | isB1OnA1;
+            certain = (certain1 | zero1) & (certain2 | zero2) & (certain3 | zero3) & (certain4 | zero4);
+            crossing = certain & ~(zero1 | zero2 | zero3 | zero4) & (negative1 ^ negative2) & (negative3 ^ negative4);
+            uncertain = (~certain | (zero1 & zero2 & zero3 & zero4)) & 0xFFU;
+        }
+        storeBlock(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1,
+            i, crossing, uncertain, masks);
+    }
+    findCrossingsScalarRange(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, i, count, masks);
+}
+
+KERNEL_TARGET("avx512f")
+void getOrientationAVX512(__m512 dx0, __m512 dy1, __m512 dy0, __m512 dx1,
+    unsigned int& negative, unsigned int& certain)
+{
+    const __m512 errorBound = _mm512_set1_ps(lineUtils::orientationErrorBound);
+    __m512 left = _mm512_mul_ps(dx0, dy1);
+    __m512 right = _mm512_mul_ps(dy0, dx1);
+    __m512 det = _mm512_sub_ps(left, right);
+    __m512 bound = _mm512_mul_ps(errorBound, _mm512_add_ps(_mm512_abs_ps(left), _mm512_abs_ps(right)));
+    negative = _mm512_cmp_ps_mask(det, _mm512_setzero_ps(), _CMP_LT_OQ);
+    certain = _mm512_cmp_ps_mask(_mm512_abs_ps(det), bound, _CMP_GT_OQ);
+}
+
+KERNEL_TARGET("avx512f")
+unsigned int getZeroFactorsAVX512(__m512 dx0, __m512 dy1, __m512 dy0, __m512 dx1)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    return static_cast<unsigned int>(((_mm512_cmp_ps_mask(dx0, zero, _CMP_EQ_OQ) | _mm512_cmp_ps_mask(dy1, zero, _CMP_EQ_OQ)) & (_mm512_cmp_ps_mask(dy0, zero, _CMP_EQ_OQ) | _mm512_cmp_ps_mask(dx1, zero, _CMP_EQ_OQ))));
+}
+
+KERNEL_TARGET("avx512f")
+unsigned int getEqualPointsAVX512(__m512 x0, __m512 y0, __m512 x1, __m512 y1)
+{
+    return static_cast<unsigned int>((_mm512_cmp_ps_mask(x0, x1, _CMP_EQ_OQ) & _mm512_cmp_ps_mask(y0, y1, _CMP_EQ_OQ)));
+}
+
+KERNEL_TARGET("avx512f")
+void findCrossingsAVX512(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks)
+{
+    const __m512 vax0 = _mm512_set1_ps(ax0);
+    const __m512 vay0 = _mm512_set1_ps(ay0);
+    const __m512 vax1 = _mm512_set1_ps(ax1);
+    const __m512 vay1 = _mm512_set1_ps(ay1);
+    const __m512 dxA = _mm512_set1_ps(ax1 - ax0);
+    const __m512 dyA = _mm512_set1_ps(ay1 - ay0);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 vbx0 = _mm512_loadu_ps(bx0 + i);
+        __m512 vby0 = _mm512_loadu_ps(by0 + i);
+        __m512 vbx1 = _mm512_loadu_ps(bx1 + i);
+        __m512 vby1 = _mm512_loadu_ps(by1 + i);
+        __m512 dxB = _mm512_sub_ps(vbx1, vbx0);
+        __m512 dyB = _mm512_sub_ps(vby1, vby0);
+        __m512 dx1 = _mm512_sub_ps(vbx0, vax0);
+        __m512 dy1 = _mm512_sub_ps(vby0, vay0);
+        __m512 dx2 = _mm512_sub_ps(vbx1, vax0);
+        __m512 dy2 = _mm512_sub_ps(vby1, vay0);
+        __m512 dx3 = _mm512_sub_ps(vax0, vbx0);
+        __m512 dy3 = _mm512_sub_ps(vay0, vby0);
+        __m512 dx4 = _mm512_sub_ps(vax1, vbx0);
+        __m512 dy4 = _mm512_sub_ps(vay1, vby0);
+
+        unsigned int negative1, negative2, negative3, negative4;
+        unsigned int certain1, certain2, certain3, certain4;
+        getOrientationAVX512(dxA, dy1, dyA, dx1, negative1, certain1);
+        getOrientationAVX512(dxA, dy2, dyA, dx2, negative2, certain2);
+        getOrientationAVX512(dxB, dy3, dyB, dx3, negative3, certain3);
+        getOrientationAVX512(dxB, dy4, dyB, dx4, negative4, certain4);
+        unsigned int certain = certain1 & certain2 & certain3 & certain4;
+        unsigned int crossing = certain & (negative1 ^ negative2) & (negative3 ^ negative4);
+        unsigned int uncertain = ~certain & 0xFFFFU;
+        if (uncertain != 0) {
+            unsigned int isB1OnA1 = getEqualPointsAVX512(vbx1, vby1, vax1, vay1);
+            unsigned int zero1 = getZeroFactorsAVX512(dxA, dy1, dyA, dx1) | getEqualPointsAVX512(vbx0, vby0, vax1, vay1);
+            unsigned int zero2 = getZeroFactorsAVX512(dxA, dy2, dyA, dx2) | isB1OnA1;
+            unsigned int zero3 = getZeroFactorsAVX512(dxB, dy3, dyB, dx3) | getEqualPointsAVX512(vbx1, vby1, vax0, vay0);
+            unsigned int zero4 = getZeroFactorsAVX512(dxB, dy4, dyB, dx4) | isB1OnA1;
+            certain = (certain1 | zero1) & (certain2 | zero2) & (certain3 | zero3) & (certain4 | zero4);
+            crossing = certain & ~(zero1 | zero2 | zero3 | zero4) & (negative1 ^ negative2) & (negative3 ^ negative4);
+            uncertain = (~certain | (zero1 & zero2 & zero3 & zero4)) & 0xFFFFU;
+        }
+        storeBlock(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1,
+            i, crossing, uncertain, masks);
+    }
+    findCrossingsScalarRange(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, i, count, masks);
+}
+
+#if defined(_MSC_VER)
+uint64_t getEnabledXStates()
+{
+    return _xgetbv(0);
+}
+#endif
+
+crossingKernel::InstructionSet detectInstructionSet()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool hasSSE42 = (info[2] & (1 << 20)) != 0;
+    bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+    bool hasAVX = (info[2] & (1 << 28)) != 0;
+    bool hasAVX2 = false;
+    bool hasAVX512 = false;
+    if (maxLeaf >= 7 && hasOSXSave && hasAVX) {
+        // The OS has to save the vector registers on context switches
+        uint64_t xStates = getEnabledXStates();
+        __cpuidex(info, 7, 0);
+        hasAVX2 = (xStates & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        hasAVX512 = (xStates & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool hasSSE42 = __builtin_cpu_supports("sse4.2") != 0;
+    bool hasAVX2 = __builtin_cpu_supports("avx2") != 0;
+    bool hasAVX512 = __builtin_cpu_supports("avx512f") != 0;
+#endif
+    if (hasAVX512) {
+        return crossingKernel::AVX512;
+    }
+    if (hasAVX2) {
+        return crossingKernel::AVX2;
+    }
+    if (hasSSE42) {
+        return crossingKernel::SSE42;
+    }
+    return crossingKernel::SCALAR;
+}
+
+#else
+
+crossingKernel::InstructionSet detectInstructionSet()
+{
+    return crossingKernel::SCALAR;
+}
+
+#endif
+
+KernelFunc getKernel(crossingKernel::InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+#ifdef CROSSING_KERNEL_X86
+    case crossingKernel::SSE42:
+        return findCrossingsSSE42;
+    case crossingKernel::AVX2:
+        return findCrossingsAVX2;
+    case crossingKernel::AVX512:
+        return findCrossingsAVX512;
+#endif
+    default:
+        return findCrossingsScalar;
+    }
+}
+
+crossingKernel::InstructionSet& currentInstructionSet()
+{
+    static crossingKernel::InstructionSet instructionSet = crossingKernel::getSupportedInstructionSet();
+    return instructionSet;
+}
+
+KernelFunc& currentKernel()
+{
+    static KernelFunc kernel = getKernel(currentInstructionSet());
+    return kernel;
+}
+
+} // namespace
+
+namespace crossingKernel {
+
+InstructionSet getSupportedInstructionSet()
+{
+    static const InstructionSet supported = detectInstructionSet();
+    return supported;
+}
+
+InstructionSet getInstructionSet()
+{
+    return currentInstructionSet();
+}
+
+InstructionSet setInstructionSet(InstructionSet instructionSet)
+{
+    if (instructionSet <= getSupportedInstructionSet()) {
+        currentInstructionSet() = instructionSet;
+        currentKernel() = getKernel(instructionSet);
+    }
+    return currentInstructionSet();
+}
+
+const char* getName(InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+    case SSE42:
+        return "SSE4.2";
+    case AVX2:
+        return "AVX2";
+    case AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+void findCrossings(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks)
+{
+    std::fill(masks, masks + getMaskSize(count), 0U);
+    currentKernel()(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, count, masks);
+}
+}
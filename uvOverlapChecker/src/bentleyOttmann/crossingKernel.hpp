@@ -0,0 +1,49 @@
+//
+//  crossingKernel.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Tests one segment against many candidate segments at once. Candidates are
+// read from structure of arrays end points, 4/8/16 of them per instruction
+// depending on what the CPU supports. Results are exactly the same as
+// lineUtils::isCrossing for every pair, whatever the instruction set is
+namespace crossingKernel {
+
+enum InstructionSet {
+    SCALAR,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+// Best instruction set supported by the CPU and the OS
+InstructionSet getSupportedInstructionSet();
+
+// Instruction set used by findCrossings, the supported one by default
+InstructionSet getInstructionSet();
+
+// Force an instruction set, mainly for benchmarking. Sets which are not
+// supported are ignored. Not thread safe, call it before any check starts.
+// Returns the instruction set in use afterwards
+InstructionSet setInstructionSet(InstructionSet instructionSet);
+
+const char* getName(InstructionSet instructionSet);
+
+// Number of 32 bit mask words needed for count candidates
+inline size_t getMaskSize(size_t count)
+{
+    return (count + 31) / 32;
+}
+
+// Test segment A (ax0, ay0)-(ax1, ay1) against count candidate segments
+// (bx0[i], by0[i])-(bx1[i], by1[i]). Bit i of the masks is set if A crosses
+// candidate i, masks must hold getMaskSize(count) words
+void findCrossings(float ax0, float ay0, float ax1, float ay1,
+    const float* bx0, const float* by0, const float* bx1, const float* by1,
+    size_t count, uint32_t* masks);
+}
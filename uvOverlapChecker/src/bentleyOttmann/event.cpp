@@ -7,20 +7,20 @@
 
 Event::Event() = default;
 
-Event::Event(int eventType, LineSegment* edgePtrA, const Point2D& point)
-    : eventType(eventType)
-    , edgePtrA(edgePtrA)
-    , eventPoint(point)
-    , sweepline(point.x)
+Event::Event(int eventType, unsigned int edgeA, float x, float y)
+    : x(x)
+    , y(y)
+    , eventType(eventType)
+    , edgeA(edgeA)
 {
 }
 
-Event::Event(int eventType, LineSegment* edgePtrA, LineSegment* edgePtrB, const Point2D& point)
-    : eventType(eventType)
-    , edgePtrA(edgePtrA)
-    , edgePtrB(edgePtrB)
-    , eventPoint(point)
-    , sweepline(point.x)
+Event::Event(int eventType, unsigned int edgeA, unsigned int edgeB, float x, float y)
+    : x(x)
+    , y(y)
+    , eventType(eventType)
+    , edgeA(edgeA)
+    , edgeB(edgeB)
 {
 }
 
@@ -28,5 +28,15 @@ Event::~Event() = default;
 
 bool Event::operator<(const Event& rhs) const
 {
-    return this->eventPoint < rhs.eventPoint;
+    if (this->x != rhs.x) {
+        return this->x < rhs.x;
+    }
+    // On the same sweepline, swap crossing edges before removing finished
+    // ones, and remove those before inserting new edges, so that new edges
+    // find the status tree in its order past the sweepline
+    static const int order[] = { 2, 1, 0 }; // BEGIN, END, CROSS
+    if (this->eventType != rhs.eventType) {
+        return order[this->eventType] < order[rhs.eventType];
+    }
+    return this->y < rhs.y;
 }
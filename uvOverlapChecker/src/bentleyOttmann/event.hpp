@@ -5,24 +5,26 @@
 
 #pragma once
 
-#include "lineSegment.hpp"
-#include "point2D.hpp"
 #include <cstdio>
 
 class Event {
 public:
     Event();
-    Event(int eventType, LineSegment* edgePtrA, const Point2D& point);
-    Event(int eventType, LineSegment* edgePtrA, LineSegment* edgePtrB, const Point2D& point);
+    Event(int eventType, unsigned int edgeA, float x, float y);
+    Event(int eventType, unsigned int edgeA, unsigned int edgeB, float x, float y);
     ~Event();
 
+    // Event point. x is also the position of the sweepline
+    float x{}, y{};
     int eventType{};
-    LineSegment *edgePtrA{}, *edgePtrB{};
-    Point2D eventPoint;
-    int index{};
-    float sweepline{};
+    // Edges of the event, as indices into the edges of the sweep
+    unsigned int edgeA{}, edgeB{};
 
     bool operator<(const Event& rhs) const;
+    inline bool operator>(const Event& rhs) const
+    {
+        return rhs < *this;
+    }
 
     enum EVENT_TYPE {
         BEGIN,
@@ -0,0 +1,201 @@
+//
+//  lineUtils.cpp
+//  bentleyOttmann
+//
+
+#include "lineUtils.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Sign of the sum of terms without rounding errors. Terms are added to an
+// expansion, a sum of non overlapping doubles of growing magnitude, with
+// Knuth's two-sum. The largest component of the expansion has the sign of
+// the sum. terms is used as the storage of the expansion
+int getExactSign(double* terms, int numTerms)
+{
+    int size = 0;
+    for (int i = 0; i < numTerms; i++) {
+        double q = terms[i];
+        int newSize = 0;
+        for (int j = 0; j < size; j++) {
+            double sum = q + terms[j];
+            double bVirtual = sum - q;
+            double aVirtual = sum - bVirtual;
+            double error = (q - aVirtual) + (terms[j] - bVirtual);
+            q = sum;
+            if (error != 0.0) {
+                terms[newSize++] = error;
+            }
+        }
+        if (q != 0.0) {
+            terms[newSize++] = q;
+        }
+        size = newSize;
+    }
+    if (size == 0) {
+        return 0;
+    }
+    return terms[size - 1] > 0.0 ? 1 : -1;
+}
+
+// a * b * c as the sum of two doubles without rounding errors. a * b is exact
+// in double, and is split into two halves of 26 bits whose products with c
+// fit in a double (Veltkamp's split)
+void getExactProduct(float a, float b, float c, double* terms)
+{
+    double ab = static_cast<double>(a) * b;
+    double split = 134217729.0 * ab;
+    double high = split - (split - ab);
+    double low = ab - high;
+    terms[0] = high * c;
+    terms[1] = low * c;
+}
+
+double clamp(double value, double low, double high)
+{
+    return std::min(std::max(value, low), high);
+}
+
+} // namespace
+
+namespace lineUtils {
+
+// Products of two floats are exact in double, so the cross product expanded
+// into eight of them is exact once summed with getExactSign
+int getExactCrossSign(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1)
+{
+    double terms[8] = {
+        static_cast<double>(ax1) * by1,
+        -static_cast<double>(ax1) * by0,
+        -static_cast<double>(ax0) * by1,
+        static_cast<double>(ax0) * by0,
+        -static_cast<double>(ay1) * bx1,
+        static_cast<double>(ay1) * bx0,
+        static_cast<double>(ay0) * bx1,
+        -static_cast<double>(ay0) * bx0
+    };
+    return getExactSign(terms, 8);
+}
+
+// Difference of compareYAtX expanded into 16 products of three floats, each
+// one split into two doubles
+int getExactYAtXOrder(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1, float x)
+{
+    const float factorsA[4][2] = { { ay0, ax1 }, { -ay0, x }, { ay1, x }, { -ay1, ax0 } };
+    const float factorsB[4][2] = { { by0, bx1 }, { -by0, x }, { by1, x }, { -by1, bx0 } };
+    double terms[32];
+    int numTerms = 0;
+    for (int i = 0; i < 4; i++) {
+        getExactProduct(factorsA[i][0], factorsA[i][1], bx1, terms + numTerms);
+        getExactProduct(factorsA[i][0], factorsA[i][1], -bx0, terms + numTerms + 2);
+        getExactProduct(factorsB[i][0], factorsB[i][1], -ax1, terms + numTerms + 4);
+        getExactProduct(factorsB[i][0], factorsB[i][1], ax0, terms + numTerms + 6);
+        numTerms += 8;
+    }
+    return getExactSign(terms, numTerms);
+}
+
+bool isCrossing(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1)
+{
+    // Float path of the orientations, the same as in the crossing kernel.
+    // Most pairs are decided here, and most of those by the first two, with
+    // edge B on one side of edge A
+    float dxA = ax1 - ax0;
+    float dyA = ay1 - ay0;
+    float left1 = dxA * (by0 - ay0);
+    float right1 = dyA * (bx0 - ax0);
+    float left2 = dxA * (by1 - ay0);
+    float right2 = dyA * (bx1 - ax0);
+    float det1 = left1 - right1;
+    float det2 = left2 - right2;
+    // Bitwise operators on purpose, one well predicted branch is faster
+    // than one per orientation
+    bool isCertain = (std::abs(det1) > orientationErrorBound * (std::abs(left1) + std::abs(right1)))
+        & (std::abs(det2) > orientationErrorBound * (std::abs(left2) + std::abs(right2)));
+    if (isCertain && (det1 < 0.0F) == (det2 < 0.0F)) {
+        return false;
+    }
+    float dxB = bx1 - bx0;
+    float dyB = by1 - by0;
+    float left3 = dxB * (ay0 - by0);
+    float right3 = dyB * (ax0 - bx0);
+    float left4 = dxB * (ay1 - by0);
+    float right4 = dyB * (ax1 - bx0);
+    float det3 = left3 - right3;
+    float det4 = left4 - right4;
+    isCertain = isCertain & (std::abs(det3) > orientationErrorBound * (std::abs(left3) + std::abs(right3)))
+        & (std::abs(det4) > orientationErrorBound * (std::abs(left4) + std::abs(right4)));
+    if (isCertain) {
+        return (det3 < 0.0F) != (det4 < 0.0F);
+    }
+
+    // Otherwise one edge is on one side of the other one in most cases
+    int o1 = getOrientation(ax0, ay0, ax1, ay1, bx0, by0);
+    int o2 = getOrientation(ax0, ay0, ax1, ay1, bx1, by1);
+    if (o1 == o2 && o1 != 0) {
+        return false;
+    }
+    int o3 = getOrientation(bx0, by0, bx1, by1, ax0, ay0);
+    int o4 = getOrientation(bx0, by0, bx1, by1, ax1, ay1);
+    if (o3 == o4 && o3 != 0) {
+        return false;
+    }
+
+    if (o1 == 0 && o2 == 0 && o3 == 0 && o4 == 0) {
+        return isOverlapping(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1);
+    }
+
+    // An end point on the other edge is a touch, not a crossing
+    if (o1 == 0 || o2 == 0 || o3 == 0 || o4 == 0) {
+        return false;
+    }
+    return true;
+}
+
+bool isOverlapping(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1)
+{
+    // Points of a line are in the same order along x as along the line,
+    // unless the line is vertical
+    bool isAlongX = ax0 != ax1 || bx0 != bx1;
+    float a0 = isAlongX ? ax0 : ay0;
+    float a1 = isAlongX ? ax1 : ay1;
+    float b0 = isAlongX ? bx0 : by0;
+    float b1 = isAlongX ? bx1 : by1;
+    return (a0 < b1 && a1 > b0) || (a0 > b1 && a1 < b0);
+}
+
+bool getIntersectionPoint(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1,
+    float& x, float& y)
+{
+    if (getCrossSign(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1) == 0) {
+        return false;
+    }
+
+    // A(t) = A0 + t (A1 - A0), solved for the line of B. Vertical and
+    // horizontal edges need no special case
+    double dxA = static_cast<double>(ax1) - ax0;
+    double dyA = static_cast<double>(ay1) - ay0;
+    double dxB = static_cast<double>(bx1) - bx0;
+    double dyB = static_cast<double>(by1) - by0;
+    double denominator = dxA * dyB - dyA * dxB;
+    double t = ((static_cast<double>(bx0) - ax0) * dyB - (static_cast<double>(by0) - ay0) * dxB) / denominator;
+    t = clamp(t, 0.0, 1.0);
+
+    // Rounding must not move the point out of either edge, the sweep relies
+    // on the point being where both edges still are
+    double left = std::max(std::min(ax0, ax1), std::min(bx0, bx1));
+    double right = std::min(std::max(ax0, ax1), std::max(bx0, bx1));
+    double bottom = std::max(std::min(ay0, ay1), std::min(by0, by1));
+    double top = std::min(std::max(ay0, ay1), std::max(by0, by1));
+    x = static_cast<float>(clamp(ax0 + t * dxA, left, right));
+    y = static_cast<float>(clamp(ay0 + t * dyA, bottom, top));
+    return true;
+}
+}
@@ -0,0 +1,125 @@
+//
+//  lineUtils.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+// Predicates are computed in float first, with an error bound telling whether
+// the sign of the result can be trusted. Only when it can't, which mostly
+// happens for points on a line or on a pixel grid, the exact sign is worked
+// out from float products summed without rounding errors
+namespace lineUtils {
+
+// Relative error bound of the float orientation, (3 + 16 eps) eps with
+// eps = 2^-24. A result larger than this times the sum of the magnitudes of
+// its two products has the right sign
+const float orientationErrorBound = 1.788140e-07F;
+
+// Exact sign of the cross product, for when the float one is not certain
+int getExactCrossSign(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1);
+
+// Sign of the cross product of (ax1 - ax0, ay1 - ay0) and (bx1 - bx0, by1 - by0).
+// Positive if direction B turns counter clockwise from direction A, zero if
+// they are parallel
+inline int getCrossSign(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1)
+{
+    float dxA = ax1 - ax0;
+    float dyA = ay1 - ay0;
+    float dxB = bx1 - bx0;
+    float dyB = by1 - by0;
+    float left = dxA * dyB;
+    float right = dyA * dxB;
+    float det = left - right;
+    float bound = orientationErrorBound * (std::abs(left) + std::abs(right));
+    if (det > bound) {
+        return 1;
+    }
+    if (-det > bound) {
+        return -1;
+    }
+
+    // A float difference is zero only if both values are equal, which makes
+    // both products exactly zero. This is the case of shared end points and
+    // of most axis aligned edges
+    if ((dxA == 0.0F || dyB == 0.0F) && (dyA == 0.0F || dxB == 0.0F)) {
+        return 0;
+    }
+    return getExactCrossSign(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1);
+}
+
+// Positive if C is on the left side of A->B, negative if on the right side
+// and zero if the three points are on a same line
+inline int getOrientation(float ax, float ay, float bx, float by, float cx, float cy)
+{
+    // C on an end point of A->B is the usual shared vertex, which the float
+    // path can't tell from a point close to the line
+    if ((cx == bx && cy == by) || (cx == ax && cy == ay)) {
+        return 0;
+    }
+    return getCrossSign(ax, ay, bx, by, ax, ay, cx, cy);
+}
+
+// Relative error bound of the double path of compareYAtX. 8 units of
+// roundoff, a bit more than the 6 roundings each of its terms goes through
+const double yAtXErrorBound = 4.0 * std::numeric_limits<double>::epsilon();
+
+// Exact sign of compareYAtX, for when the double one is not certain
+int getExactYAtXOrder(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1, float x);
+
+// Sign of yA - yB, where yA and yB are the y values of the lines of segments
+// A and B at x. Neither segment may be vertical, and both must have their
+// begin point on the left like in the segment store
+inline int compareYAtX(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1, float x)
+{
+    // yA (ax1 - ax0) = ay0 (ax1 - x) + ay1 (x - ax0), and the same for B.
+    // Both widths are positive, so multiplying each side by the width of the
+    // other one keeps the sign and needs no division
+    double leftA = static_cast<double>(ax1) - x;
+    double rightA = static_cast<double>(x) - ax0;
+    double leftB = static_cast<double>(bx1) - x;
+    double rightB = static_cast<double>(x) - bx0;
+    double widthA = static_cast<double>(ax1) - ax0;
+    double widthB = static_cast<double>(bx1) - bx0;
+    double termA = (ay0 * leftA + ay1 * rightA) * widthB;
+    double termB = (by0 * leftB + by1 * rightB) * widthA;
+    double difference = termA - termB;
+    double bound = yAtXErrorBound * ((std::abs(ay0 * leftA) + std::abs(ay1 * rightA)) * widthB
+        + (std::abs(by0 * leftB) + std::abs(by1 * rightB)) * widthA);
+    if (difference > bound) {
+        return 1;
+    }
+    if (-difference > bound) {
+        return -1;
+    }
+
+    // Mostly edges crossing right at x, or an end point of one on the other
+    return getExactYAtXOrder(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1, x);
+}
+
+// Returns true if segment A (ax0, ay0)-(ax1, ay1) and segment B cross each
+// other. Segments touching at a shared end point don't count as crossing,
+// collinear segments do if they overlap
+bool isCrossing(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1);
+
+// Same as the collinear case of isCrossing, for segments on a same line.
+// A begins before the end of B and ends after the begin of B, or the other
+// way round
+bool isOverlapping(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1);
+
+// Point where the lines of segment A and segment B meet, computed in double
+// and kept within the bounding boxes of both segments. Returns false if the
+// segments are parallel
+bool getIntersectionPoint(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1,
+    float& x, float& y);
+}
@@ -4,85 +4,732 @@
 //
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iterator>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "bentleyOttmann.hpp"
-#include "lineSegment.hpp"
-#include "point2D.hpp"
+#include "bruteForce.hpp"
+#include "crossingKernel.hpp"
+#include "lineUtils.hpp"
+#include "overlapArea.hpp"
+#include "polygonTriangulator.hpp"
+#include "segmentStore.hpp"
 #include "testData/dataSet.hpp"
+#include "triangleBvh.hpp"
+#include "uniformGrid.hpp"
 
+static void loadEdges(const std::string& path, unsigned int meshId, SegmentStore& store)
+{
+    std::vector<std::vector<std::string> > v = TestDataSet::getDataSet(path);
+
+    for (size_t i = 0; i < v.size(); i++) {
+        int indexA = std::stoi(v[i][0]);
+        float x1 = std::stof(v[i][1]);
+        float y1 = std::stof(v[i][2]);
+
+        int indexB = std::stoi(v[i][3]);
+        float x2 = std::stof(v[i][4]);
+        float y2 = std::stof(v[i][5]);
+
+        store.add(x1, y1, indexA, x2, y2, indexB, meshId);
+    }
+}
+
+// Lay out square UV shells made of quads on a jittered grid, shifting some of
+// them by half a cell so that roughly one in four shells overlaps another one.
+// Edges of each shell are next to each other in the store
+static void createLayout(size_t numSegments, int quadsPerSide, unsigned int seed, SegmentStore& store)
+{
+    const auto segmentsPerShell = static_cast<size_t>(2 * quadsPerSide * (quadsPerSide + 1));
+    size_t numShells = numSegments / segmentsPerShell + 1;
+    auto shellsPerRow = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(numShells))));
+    float cellSize = 1.0F / static_cast<float>(shellsPerRow);
+    float quadSize = cellSize * 0.9F / static_cast<float>(quadsPerSide);
 
-int test() {
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<float> jitter(-0.1F, 0.1F);
+    std::uniform_int_distribution<int> shift(0, 3);
 
-    std::vector<LineSegment> edgeVec;
-    std::vector<LineSegment> edgeVec2;
+    store.clear();
+    store.reserve(numShells * segmentsPerShell);
+    int uvIndex = 0;
 
+    for (size_t s = 0; s < numShells && store.size() < numSegments; s++) {
+        float originU = static_cast<float>(s % shellsPerRow) * cellSize;
+        float originV = static_cast<float>(s / shellsPerRow) * cellSize;
+        if (shift(engine) == 0) {
+            originU += cellSize * 0.5F;
+        }
+
+        std::vector<float> u, v;
+        for (int i = 0; i <= quadsPerSide; i++) {
+            for (int j = 0; j <= quadsPerSide; j++) {
+                u.emplace_back(originU + (static_cast<float>(i) + jitter(engine)) * quadSize);
+                v.emplace_back(originV + (static_cast<float>(j) + jitter(engine)) * quadSize);
+            }
+        }
+        for (int i = 0; i <= quadsPerSide; i++) {
+            for (int j = 0; j <= quadsPerSide; j++) {
+                int p = i * (quadsPerSide + 1) + j;
+                int right = (i + 1) * (quadsPerSide + 1) + j;
+                int up = p + 1;
+                if (i < quadsPerSide) {
+                    store.add(u[static_cast<size_t>(p)], v[static_cast<size_t>(p)], uvIndex + p,
+                        u[static_cast<size_t>(right)], v[static_cast<size_t>(right)], uvIndex + right, 0);
+                }
+                if (j < quadsPerSide) {
+                    store.add(u[static_cast<size_t>(p)], v[static_cast<size_t>(p)], uvIndex + p,
+                        u[static_cast<size_t>(up)], v[static_cast<size_t>(up)], uvIndex + up, 0);
+                }
+            }
+        }
+        uvIndex += (quadsPerSide + 1) * (quadsPerSide + 1);
+    }
+    store.resize(std::min(store.size(), numSegments));
+}
+
+int test()
+{
     std::string dataPathA = "./testData/DataA-Table_1.csv";
     std::string dataPathB = "./testData/DataB-Table_1.csv";
-    std::vector<std::vector<std::string> > v1 = TestDataSet::getDataSet(dataPathA);
-    std::vector<std::vector<std::string> > v2 = TestDataSet::getDataSet(dataPathB);
+    std::vector<std::string> groupNames = { "lineGroupA", "lineGroupB" };
+
+    SegmentStore store;
+    loadEdges(dataPathA, 0, store);
+    loadEdges(dataPathB, 1, store);
+
+    BentleyOttmann checker(store);
+    checker.addSegments(0, store.size());
+    std::vector<unsigned int> result;
+    checker.check(result);
+
+    for (unsigned int index : result) {
+        std::cout << store.uvA[index] << ":" << store.uvB[index] << " :: " << std::endl;
+        std::cout << groupNames[store.meshId[index]] << std::endl;
+    }
+    return 0;
+}
+
+int benchmark()
+{
+    std::cout << "segments,seconds,crossingEdges" << std::endl;
+
+    SegmentStore store;
+    for (size_t numSegments = 1000; numSegments <= 1000000; numSegments *= 10) {
+        createLayout(numSegments, 8, 1, store);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned int> result;
+        BentleyOttmann checker(store);
+        checker.addSegments(0, store.size());
+        checker.check(result);
+        auto end = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << store.size() << "," << elapsed.count() << "," << result.size() << std::endl;
+    }
+    return 0;
+}
+
+// Throughput of the crossing kernel for each instruction set the CPU
+// supports. Every edge of a layout is tested against all the others
+int benchmarkKernel()
+{
+    std::cout << "instructionSet,pairsPerSecond,crossings" << std::endl;
+
+    SegmentStore store;
+    createLayout(4096, 8, 1, store);
+    size_t numEdges = store.size();
+    std::vector<uint32_t> masks(crossingKernel::getMaskSize(numEdges));
+
+    crossingKernel::InstructionSet supported = crossingKernel::getSupportedInstructionSet();
+    for (int i = crossingKernel::SCALAR; i <= supported; i++) {
+        crossingKernel::setInstructionSet(static_cast<crossingKernel::InstructionSet>(i));
+
+        size_t numPairs = 0;
+        size_t numCrossings = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed(0);
+        while (elapsed.count() < 0.5) {
+            for (size_t edge = 0; edge < numEdges; edge++) {
+                store.findCrossings(edge, 0, numEdges, masks.data());
+                for (uint32_t mask : masks) {
+                    for (; mask != 0; mask &= mask - 1) {
+                        numCrossings++;
+                    }
+                }
+            }
+            numPairs += numEdges * numEdges;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+
+        std::cout << crossingKernel::getName(crossingKernel::getInstructionSet()) << ","
+                  << static_cast<double>(numPairs) / elapsed.count() << ","
+                  << numCrossings * numEdges * numEdges / numPairs << std::endl;
+    }
+    crossingKernel::setInstructionSet(supported);
+    return 0;
+}
+
+// Time per shell of the sweep and of the brute force check for growing
+// shell sizes, to find where the sweep starts to pay off
+int benchmarkCrossover()
+{
+    std::cout << "edgesPerShell,sweepMicroseconds,bruteForceMicroseconds" << std::endl;
+
+    const int quadCounts[] = { 1, 2, 3, 4, 5, 6, 8, 11, 16, 23, 32 };
+    SegmentStore store;
+    std::vector<unsigned int> result;
+    for (int quadsPerSide : quadCounts) {
+        createLayout(200000, quadsPerSide, 1, store);
+        auto segmentsPerShell = static_cast<size_t>(2 * quadsPerSide * (quadsPerSide + 1));
+        size_t numShells = store.size() / segmentsPerShell;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numShells; i++) {
+            result.clear();
+            BentleyOttmann checker(store);
+            checker.addSegments(i * segmentsPerShell, (i + 1) * segmentsPerShell);
+            checker.check(result);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numShells; i++) {
+            result.clear();
+            bruteForce::check(store, i * segmentsPerShell, (i + 1) * segmentsPerShell, result);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::micro> sweepTime = middle - start;
+        std::chrono::duration<double, std::micro> bruteForceTime = end - middle;
+        std::cout << segmentsPerShell << ","
+                  << sweepTime.count() / static_cast<double>(numShells) << ","
+                  << bruteForceTime.count() / static_cast<double>(numShells) << std::endl;
+    }
+    return 0;
+}
+
+// Split one big shell into slabs, and compare the time of the whole sweep
+// with the total and the longest time of the slab sweeps. The longest one is
+// what a check on as many cores as slabs would take
+int benchmarkSlabs()
+{
+    std::cout << "slabs,seconds,totalSlabSeconds,longestSlabSeconds,crossingEdges" << std::endl;
+
+    SegmentStore store;
+    createLayout(1000000, 8, 1, store);
+
+    const size_t slabCounts[] = { 1, 2, 4, 8, 16, 32 };
+    for (size_t numSlabs : slabCounts) {
+        std::vector<float> borders;
+        auto start = std::chrono::steady_clock::now();
+        BentleyOttmann::getSlabBorders(store, 0, store.size(), numSlabs, borders);
+
+        std::chrono::duration<double> total(0);
+        std::chrono::duration<double> longest(0);
+        size_t numCrossingEdges = 0;
+        for (size_t i = 0; i + 1 < borders.size(); i++) {
+            auto slabStart = std::chrono::steady_clock::now();
+            std::vector<unsigned int> result;
+            BentleyOttmann checker(store);
+            checker.addSegments(0, store.size(), BentleyOttmann::RED,
+                borders[i], -std::numeric_limits<float>::infinity(),
+                borders[i + 1], std::numeric_limits<float>::infinity());
+            checker.setSlab(borders[i], borders[i + 1]);
+            checker.check(result);
+            numCrossingEdges += result.size();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - slabStart;
+            total += elapsed;
+            longest = std::max(longest, elapsed);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << borders.size() - 1 << "," << elapsed.count() << "," << total.count() << ","
+                  << longest.count() << "," << numCrossingEdges << std::endl;
+    }
+    return 0;
+}
+
+// Pairs of edges crossing in an X, stacked apart from each other, so that
+// every crossing of the layout is at the same x. Snapped UVs line crossings
+// up like this, and the sweep does them all at one sweepline
+int benchmarkSameX()
+{
+    std::cout << "segments,seconds,crossingEdges" << std::endl;
+
+    SegmentStore store;
+    for (int numPairs = 1000; numPairs <= 100000; numPairs *= 10) {
+        store.clear();
+        for (int i = 0; i < numPairs; i++) {
+            auto y = static_cast<float>(i * 4);
+            store.add(0, y, i * 4, 2, y + 2, i * 4 + 1, 0);
+            store.add(0, y + 2, i * 4 + 2, 2, y, i * 4 + 3, 0);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned int> result;
+        BentleyOttmann checker(store);
+        checker.addSegments(0, store.size());
+        checker.check(result);
+        auto end = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << store.size() << "," << elapsed.count() << "," << result.size() << std::endl;
+    }
+    return 0;
+}
+
+// Crossing pairs of a result, smaller index first, sorted
+static std::vector<std::pair<unsigned int, unsigned int> > getPairs(const std::vector<unsigned int>& result)
+{
+    std::vector<std::pair<unsigned int, unsigned int> > pairs;
+    for (size_t i = 0; i + 1 < result.size(); i += 2) {
+        pairs.emplace_back(std::min(result[i], result[i + 1]), std::max(result[i], result[i + 1]));
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    return pairs;
+}
+
+// Time the sweep and the uniform grid on the same layouts, and count the
+// crossing pairs found by only one of them
+int benchmarkBackends()
+{
+    unsigned int numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    std::cout << "segments,sweepSeconds,gridSeconds,gridSeconds" << numThreads << "Threads,"
+              << "crossingPairs,onlySweep,onlyGrid" << std::endl;
 
-    for (size_t i = 0; i < v1.size(); i++) {
-        int indexA = std::stoi(v1[i][0]);
-        float x1 = std::stof(v1[i][1]);
-        float y1 = std::stof(v1[i][2]);
+    SegmentStore store;
+    for (size_t numSegments = 10000; numSegments <= 1000000; numSegments *= 10) {
+        createLayout(numSegments, 8, 1, store);
 
-        int indexB = std::stoi(v1[i][3]);
-        float x2 = std::stof(v1[i][4]);
-        float y2 = std::stof(v1[i][5]);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned int> sweepResult;
+        BentleyOttmann checker(store);
+        checker.addSegments(0, store.size());
+        checker.check(sweepResult);
+        std::chrono::duration<double> sweepTime = std::chrono::steady_clock::now() - start;
 
-        Point2D p1(x1, y1, indexA);
-        Point2D p2(x2, y2, indexB);
+        start = std::chrono::steady_clock::now();
+        std::vector<unsigned int> gridResult;
+        UniformGrid grid(store);
+        grid.addSegments(0, store.size());
+        grid.check(gridResult);
+        std::chrono::duration<double> gridTime = std::chrono::steady_clock::now() - start;
 
-        LineSegment edge(p1, p2);
-        edgeVec.push_back(edge);
+        start = std::chrono::steady_clock::now();
+        std::vector<unsigned int> threadedResult;
+        UniformGrid threadedGrid(store);
+        threadedGrid.addSegments(0, store.size());
+        threadedGrid.check(threadedResult, numThreads);
+        std::chrono::duration<double> threadedTime = std::chrono::steady_clock::now() - start;
+
+        std::vector<std::pair<unsigned int, unsigned int> > sweepPairs = getPairs(sweepResult);
+        std::vector<std::pair<unsigned int, unsigned int> > gridPairs = getPairs(threadedResult);
+        std::vector<std::pair<unsigned int, unsigned int> > difference;
+        std::set_difference(sweepPairs.begin(), sweepPairs.end(), gridPairs.begin(), gridPairs.end(),
+            std::back_inserter(difference));
+        size_t numOnlySweep = difference.size();
+        difference.clear();
+        std::set_difference(gridPairs.begin(), gridPairs.end(), sweepPairs.begin(), sweepPairs.end(),
+            std::back_inserter(difference));
+
+        std::cout << store.size() << "," << sweepTime.count() << "," << gridTime.count() << ","
+                  << threadedTime.count() << "," << gridPairs.size() << ","
+                  << numOnlySweep << "," << difference.size() << std::endl;
     }
+    return 0;
+}
 
-    for (size_t i = 0; i < v2.size(); i++) {
-        int indexA = std::stoi(v2[i][0]);
-        float x1 = std::stof(v2[i][1]);
-        float y1 = std::stof(v2[i][2]);
+// Edge lists the sweep used to get wrong, as x0, y0, x1, y1 of each edge.
+// The last numBlueEdges edges are blue, for a red/blue check
+struct RegressionCase {
+    const char* name;
+    std::vector<float> points;
+    size_t numBlueEdges;
+};
+
+// Edges of the list as a store, one uv index per end point
+static void loadCase(const std::vector<float>& points, SegmentStore& store)
+{
+    store.clear();
+    for (size_t i = 0; i + 3 < points.size(); i += 4) {
+        auto index = static_cast<int>(i / 2);
+        store.add(points[i], points[i + 1], index, points[i + 2], points[i + 3], index + 1, 0);
+    }
+}
 
-        int indexB = std::stoi(v2[i][3]);
-        float x2 = std::stof(v2[i][4]);
-        float y2 = std::stof(v2[i][5]);
+// Crossing pairs of the sweep and of the brute force check, which tests
+// every pair with the exact predicates. Edges from numRedEdges on are blue.
+// The sweep is split into numSlabs slabs, the way the command splits large
+// shells
+static void checkCase(const SegmentStore& store, size_t numRedEdges, size_t numSlabs,
+    std::vector<std::pair<unsigned int, unsigned int> >& sweepPairs,
+    std::vector<std::pair<unsigned int, unsigned int> >& bruteForcePairs)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    std::vector<float> borders;
+    BentleyOttmann::getSlabBorders(store, 0, store.size(), numSlabs, borders);
 
-        Point2D p1(x1, y1, indexA);
-        Point2D p2(x2, y2, indexB);
+    std::vector<unsigned int> sweepResult;
+    for (size_t i = 0; i + 1 < borders.size(); i++) {
+        BentleyOttmann checker(store);
+        checker.addSegments(0, numRedEdges, BentleyOttmann::RED, borders[i], -infinity, borders[i + 1], infinity);
+        if (numRedEdges < store.size()) {
+            checker.addSegments(numRedEdges, store.size(), BentleyOttmann::BLUE,
+                borders[i], -infinity, borders[i + 1], infinity);
+        }
+        checker.setSlab(borders[i], borders[i + 1]);
+        checker.check(sweepResult);
+    }
 
-        LineSegment edge(p1, p2);
-        edgeVec2.push_back(edge);
+    std::vector<unsigned int> bruteForceResult;
+    if (numRedEdges < store.size()) {
+        bruteForce::check(store, 0, numRedEdges, numRedEdges, store.size(), bruteForceResult);
+    } else {
+        bruteForce::check(store, 0, store.size(), bruteForceResult);
     }
 
-    // Remove duplicated line segments
-    std::sort(edgeVec.begin(), edgeVec.end(), EdgeIndexComparator());
-    edgeVec.erase(std::unique(edgeVec.begin(), edgeVec.end()), edgeVec.end());
+    sweepPairs = getPairs(sweepResult);
+    bruteForcePairs = getPairs(bruteForceResult);
+}
 
-    std::sort(edgeVec2.begin(), edgeVec2.end(), EdgeIndexComparator());
-    edgeVec.erase(std::unique(edgeVec2.begin(), edgeVec2.end()), edgeVec2.end());
+// Compare the crossing pairs of the sweep with the brute force ones, on the
+// cases above and on random edges snapped to pixel grids, where crossings of
+// three or more edges, edges ending on others and collinear edges are
+// common. The random edges are checked as one set and as half red and half
+// blue, each with one and with four slabs. Returns the number of cases
+// where they differ
+int testRegressions()
+{
+    std::cout << "case,sweepPairs,bruteForcePairs" << std::endl;
 
-    // Name line group name if necessary
-    std::string groupNameA = "lineGroupA";
-    std::string groupNameB = "lineGroupB";
-    BentleyOttman checker(edgeVec, groupNameA);
-    BentleyOttman checker2(edgeVec2, groupNameB);
+    const RegressionCase cases[] = {
+        // (10, 7) is on the third edge. The edge beginning there used to be
+        // put below it, away from the first edge it crosses
+        { "tJunction", { 4, 3, 16, 20, 10, 7, 15, 19, 3, 0, 16, 13 }, 0 },
+        // The same edges with the one beginning on another as the blue one
+        { "tJunctionRedBlue", { 4, 3, 16, 20, 3, 0, 16, 13, 10, 7, 15, 19 }, 1 },
+        // The second edge ends where the other two cross
+        { "endOnCrossing", { 0, 0.3F, 0.6F, 0.1F, 0.3F, 0.2F, 0.2F, 0.4F, 0.9F, 0.4F, 0, 0.1F }, 0 },
+        // Two collinear edges cross three collinear ones at a single point
+        { "collinearBundle", { 6, 3, 4, 3, 3, 0, 5, 4, 6, 3, 0, 3, 10, 3, 0, 3, 4, 2, 5, 4 }, 0 },
+        // The blue edge crosses the first red one. No blue edge is in the
+        // slab where the two other red ones cross
+        { "slabWithoutBlue", { 0, 0, 1, 1, 3, 0, 4, 4, 3, 4, 4, 0, 0, 1, 1, 0 }, 1 },
+    };
 
-    BentleyOttman checker3 = checker + checker2;
-    checker3.check();
+    int numFailures = 0;
+    SegmentStore store;
+    std::vector<std::pair<unsigned int, unsigned int> > sweepPairs;
+    std::vector<std::pair<unsigned int, unsigned int> > bruteForcePairs;
+    for (const RegressionCase& regressionCase : cases) {
+        loadCase(regressionCase.points, store);
+        checkCase(store, store.size() - regressionCase.numBlueEdges, 2, sweepPairs, bruteForcePairs);
+        std::cout << regressionCase.name << "," << sweepPairs.size() << "," << bruteForcePairs.size() << std::endl;
+        numFailures += sweepPairs != bruteForcePairs ? 1 : 0;
+    }
 
-    std::vector<LineSegment*>::iterator resultIter;
-    for (resultIter = checker3.resultPtr.begin(); resultIter != checker3.resultPtr.end(); ++resultIter) {
-        const LineSegment& line = *(*resultIter);
-        std::cout << line.begin.index << ":" << line.end.index << " :: " << std::endl;
-        std::cout << line.groupId << std::endl;
+    const int gridSizes[] = { 10, 20, 50, 100, 256 };
+    const char* modeNames[] = { "", "RedBlue", "Slabs", "RedBlueSlabs" };
+    const size_t numEdges = 60;
+    std::mt19937 generator(1);
+    for (int gridSize : gridSizes) {
+        std::uniform_int_distribution<int> pixel(0, gridSize);
+        auto scale = static_cast<float>(gridSize);
+        size_t numSweepPairs[4] = { 0, 0, 0, 0 };
+        size_t numBruteForcePairs[4] = { 0, 0, 0, 0 };
+        for (int trial = 0; trial < 200; trial++) {
+            std::vector<float> points(numEdges * 4);
+            for (float& point : points) {
+                point = static_cast<float>(pixel(generator)) / scale;
+            }
+            loadCase(points, store);
+            for (int mode = 0; mode < 4; mode++) {
+                size_t numRedEdges = (mode & 1) != 0 ? numEdges / 2 : numEdges;
+                size_t numSlabs = (mode & 2) != 0 ? 4 : 1;
+                checkCase(store, numRedEdges, numSlabs, sweepPairs, bruteForcePairs);
+                numSweepPairs[mode] += sweepPairs.size();
+                numBruteForcePairs[mode] += bruteForcePairs.size();
+                numFailures += sweepPairs != bruteForcePairs ? 1 : 0;
+            }
+        }
+        for (int mode = 0; mode < 4; mode++) {
+            std::cout << "grid" << gridSize << modeNames[mode] << ","
+                      << numSweepPairs[mode] << "," << numBruteForcePairs[mode] << std::endl;
+        }
+    }
+    return numFailures;
+}
+
+struct FaceCase {
+    const char* name;
+    std::vector<float> points;
+    // A point inside of the face and one outside of it
+    float insideX, insideY;
+    float outsideX, outsideY;
+};
+
+// Twice the signed area of the face, positive if it turns counter clockwise
+static double getFaceArea(const std::vector<float>& points)
+{
+    double area = 0.0;
+    size_t count = points.size() / 2;
+    for (size_t i = 0; i < count; i++) {
+        size_t next = i + 1 == count ? 0 : i + 1;
+        area += static_cast<double>(points[2 * i]) * points[2 * next + 1]
+            - static_cast<double>(points[2 * next]) * points[2 * i + 1];
+    }
+    return area;
+}
+
+// Triangulate concave faces, which a fan from the first point spills out
+// of. The triangles have to turn like the face, add up to its area and
+// contain the inside point but not the outside one. Returns the number of
+// faces where they don't
+int testTriangulation()
+{
+    std::cout << "case,triangles,area,faceArea,containsInside,containsOutside" << std::endl;
+
+    const FaceCase cases[] = {
+        // Arrow head with its reflex corner last. The fan triangle of the
+        // first three points covers the notch at (0.5, 2)
+        { "concaveQuad", { 0, 0, 4, 2, 0, 4, 1, 2 }, 2, 2, 0.5F, 2 },
+        // The same quad turning clockwise
+        { "concaveQuadClockwise", { 0, 0, 1, 2, 0, 4, 4, 2 }, 2, 2, 0.5F, 2 },
+        // U shape, the fan from its first point crosses the gap
+        { "concaveNgon", { 0, 0, 3, 0, 3, 3, 2, 3, 2, 1, 1, 1, 1, 3, 0, 3 }, 0.5F, 2, 1.5F, 2 },
+        // The diagonal from the first point runs through the reflex corner
+        { "reflexOnDiagonal", { 0, 0, 2, 0, 1, 1, 2, 2, 0, 2 }, 0.5F, 1, 1.75F, 1 },
+        // Convex face with a point on the line between its neighbours
+        { "flatCorner", { 0, 0, 1, 0, 2, 0, 2, 2, 0, 2 }, 1, 1, 3, 3 },
+    };
+
+    int numFailures = 0;
+    PolygonTriangulator triangulator;
+    std::vector<int> ids;
+    for (const FaceCase& faceCase : cases) {
+        size_t count = faceCase.points.size() / 2;
+        std::vector<float> x(count);
+        std::vector<float> y(count);
+        ids.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            x[i] = faceCase.points[2 * i];
+            y[i] = faceCase.points[2 * i + 1];
+            ids[i] = static_cast<int>(i);
+        }
+        triangulator.triangulate(x.data(), y.data(), ids.data(), count);
+
+        double faceArea = getFaceArea(faceCase.points);
+        double area = 0.0;
+        bool isWindingKept = true;
+        for (const TriangleBVH::Triangle& triangle : triangulator.triangles) {
+            double triangleArea = getFaceArea({ triangle.x0, triangle.y0, triangle.x1, triangle.y1, triangle.x2, triangle.y2 });
+            isWindingKept = isWindingKept && (triangleArea > 0.0) == (faceArea > 0.0);
+            area += triangleArea;
+        }
+        TriangleBVH bvh;
+        bvh.build(triangulator.triangles.data(), triangulator.triangles.data() + triangulator.triangles.size());
+        bool containsInside = bvh.contains(faceCase.insideX, faceCase.insideY);
+        bool containsOutside = bvh.contains(faceCase.outsideX, faceCase.outsideY);
+        std::cout << faceCase.name << "," << triangulator.triangles.size() << "," << std::fabs(area) / 2.0
+                  << "," << std::fabs(faceArea) / 2.0 << "," << containsInside << "," << containsOutside << std::endl;
+        bool isValid = isWindingKept && triangulator.triangles.size() <= count - 2
+            && std::fabs(area - faceArea) <= 1e-6 * std::fabs(faceArea) && containsInside && !containsOutside;
+        numFailures += isValid ? 0 : 1;
+    }
+
+    // A bow tie has no area and no inside, it gives no triangles
+    const float bowTie[] = { 0, 0, 1, 1, 1, 0, 0, 1 };
+    const int bowTieIds[] = { 0, 1, 2, 3 };
+    const float bowTieX[] = { bowTie[0], bowTie[2], bowTie[4], bowTie[6] };
+    const float bowTieY[] = { bowTie[1], bowTie[3], bowTie[5], bowTie[7] };
+    triangulator.triangulate(bowTieX, bowTieY, bowTieIds, 4);
+    std::cout << "bowTie," << triangulator.triangles.size() << ",0,0,0,0" << std::endl;
+    numFailures += triangulator.triangles.empty() ? 0 : 1;
+    return numFailures;
+}
+
+struct OverlapCase {
+    const char* name;
+    std::vector<float> faceA;
+    std::vector<float> faceB;
+    double area;
+};
+
+// Overlap area of two single face shells, the first one concave. A fan
+// from its first point covers its notch, which the other face overlaps, and
+// counts it on top of the face itself. Returns the number of cases where the
+// area is off
+int testOverlapArea()
+{
+    std::cout << "case,area,expectedArea" << std::endl;
+
+    const OverlapCase cases[] = {
+        // Arrow head against a square over its notch, which only overlaps
+        // the two tips of the notch
+        { "concaveQuad", { 0, 0, 4, 2, 0, 4, 1, 2 }, { 0, 1, 1, 1, 1, 3, 0, 3 }, 0.5 },
+        // U shape against a box across its gap
+        { "concaveNgon", { 0, 0, 3, 0, 3, 3, 2, 3, 2, 1, 1, 1, 1, 3, 0, 3 }, { 0.5F, 2, 2.5F, 2, 2.5F, 3, 0.5F, 3 }, 1.0 },
+        // The box fits in the gap and only touches the U
+        { "insideNotch", { 0, 0, 3, 0, 3, 3, 2, 3, 2, 1, 1, 1, 1, 3, 0, 3 }, { 1, 1.5F, 2, 1.5F, 2, 3, 1, 3 }, 0.0 },
+    };
+
+    int numFailures = 0;
+    PolygonTriangulator triangulator;
+    std::vector<int> ids;
+    for (const OverlapCase& overlapCase : cases) {
+        std::vector<TriangleBVH::Triangle> triangles;
+        float left[2], bottom[2], right[2], top[2];
+        size_t endA = 0;
+        const std::vector<float>* faces[] = { &overlapCase.faceA, &overlapCase.faceB };
+        for (int shell = 0; shell < 2; shell++) {
+            const std::vector<float>& face = *faces[shell];
+            size_t count = face.size() / 2;
+            std::vector<float> x(count);
+            std::vector<float> y(count);
+            ids.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                x[i] = face[2 * i];
+                y[i] = face[2 * i + 1];
+                ids[i] = static_cast<int>(i);
+            }
+            left[shell] = *std::min_element(x.begin(), x.end());
+            bottom[shell] = *std::min_element(y.begin(), y.end());
+            right[shell] = *std::max_element(x.begin(), x.end());
+            top[shell] = *std::max_element(y.begin(), y.end());
+            triangulator.triangulate(x.data(), y.data(), ids.data(), count);
+            triangles.insert(triangles.end(), triangulator.triangles.begin(), triangulator.triangles.end());
+            if (shell == 0) {
+                endA = triangles.size();
+            }
+        }
+        double area = overlapArea::getOverlap(triangles, 0, endA, endA, triangles.size(),
+            std::max(left[0], left[1]), std::max(bottom[0], bottom[1]),
+            std::min(right[0], right[1]), std::min(top[0], top[1]));
+        std::cout << overlapCase.name << "," << area << "," << overlapCase.area << std::endl;
+        numFailures += std::fabs(area - overlapCase.area) <= 1e-6 ? 0 : 1;
+    }
+    return numFailures;
+}
+
+// Crossing test in plain float arithmetic, as it was before the error bound
+// and the exact fallback. Only here to compare with lineUtils::isCrossing
+static float getTriangleArea(float Ax, float Ay, float Bx, float By, float Cx, float Cy)
+{
+    return ((Ax * (By - Cy)) + (Bx * (Cy - Ay)) + (Cx * (Ay - By))) * 0.5F;
+}
+
+static bool isCrossingFloat(float ax0, float ay0, float ax1, float ay1,
+    float bx0, float by0, float bx1, float by1)
+{
+    float t1 = getTriangleArea(ax0, ay0, bx0, by0, ax1, ay1);
+    float t2 = getTriangleArea(ax0, ay0, bx1, by1, ax1, ay1);
+    float t3 = getTriangleArea(bx0, by0, ax0, ay0, bx1, by1);
+    float t4 = getTriangleArea(bx0, by0, ax1, ay1, bx1, by1);
+    if (t1 == 0 && t2 == 0 && t3 == 0 && t4 == 0) {
+        return lineUtils::isOverlapping(ax0, ay0, ax1, ay1, bx0, by0, bx1, by1);
+    }
+    if (t1 * t2 == 0 || t3 * t4 == 0) {
+        return false;
+    }
+    return ((t1 >= 0) ^ (t2 < 0)) == false && ((t3 >= 0) ^ (t4 < 0)) == false;
+}
+
+// Throughput of the crossing test with plain float arithmetic and with the
+// filtered predicates, on a jittered layout and on the same layout snapped to
+// a 1000 pixel grid, where edges meet and line up far more often. Also counts
+// the pairs where plain float gets the answer wrong
+int benchmarkPredicates()
+{
+    std::cout << "layout,floatPairsPerSecond,filteredPairsPerSecond,crossings,floatErrors" << std::endl;
+
+    const char* layoutNames[] = { "jittered", "snapped" };
+    for (int layout = 0; layout < 2; layout++) {
+        SegmentStore store;
+        createLayout(4096, 8, 1, store);
+        if (layout == 1) {
+            for (size_t i = 0; i < store.size(); i++) {
+                store.set(i, std::round(store.x0[i] * 1000.0F) / 1000.0F, std::round(store.y0[i] * 1000.0F) / 1000.0F, store.uvA[i],
+                    std::round(store.x1[i] * 1000.0F) / 1000.0F, std::round(store.y1[i] * 1000.0F) / 1000.0F, store.uvB[i], store.meshId[i]);
+            }
+        }
+        size_t numEdges = store.size();
+
+        // Both tests are called through a pointer so that neither is inlined
+        // into the loop
+        bool (*const tests[2])(float, float, float, float, float, float, float, float) = {
+            isCrossingFloat, lineUtils::isCrossing
+        };
+        double pairsPerSecond[2];
+        size_t numCrossings[2] = { 0, 0 };
+        for (int method = 0; method < 2; method++) {
+            bool (*const isCrossing)(float, float, float, float, float, float, float, float) = tests[method];
+            size_t numPairs = 0;
+            auto start = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed(0);
+            while (elapsed.count() < 0.5) {
+                numCrossings[method] = 0;
+                for (size_t a = 0; a < numEdges; a++) {
+                    for (size_t b = 0; b < numEdges; b++) {
+                        numCrossings[method] += isCrossing(store.x0[a], store.y0[a], store.x1[a], store.y1[a],
+                            store.x0[b], store.y0[b], store.x1[b], store.y1[b]) ? 1U : 0U;
+                    }
+                }
+                numPairs += numEdges * numEdges;
+                elapsed = std::chrono::steady_clock::now() - start;
+            }
+            pairsPerSecond[method] = static_cast<double>(numPairs) / elapsed.count();
+        }
+
+        size_t numErrors = 0;
+        for (size_t a = 0; a < numEdges; a++) {
+            for (size_t b = 0; b < numEdges; b++) {
+                bool isCrossing = isCrossingFloat(store.x0[a], store.y0[a], store.x1[a], store.y1[a],
+                    store.x0[b], store.y0[b], store.x1[b], store.y1[b]);
+                numErrors += isCrossing != store.isCrossing(a, b) ? 1U : 0U;
+            }
+        }
+
+        std::cout << layoutNames[layout] << "," << pairsPerSecond[0] << "," << pairsPerSecond[1] << ","
+                  << numCrossings[1] << "," << numErrors << std::endl;
     }
     return 0;
 }
 
 int main(int argc, const char* argv[])
 {
-    test();
+    int status = 0;
+    if (argc > 1 && std::strcmp(argv[1], "regression") == 0) {
+        status = testRegressions() == 0 ? 0 : 1;
+    } else if (argc > 1 && std::strcmp(argv[1], "triangulation") == 0) {
+        status = testTriangulation() == 0 ? 0 : 1;
+    } else if (argc > 1 && std::strcmp(argv[1], "overlapArea") == 0) {
+        status = testOverlapArea() == 0 ? 0 : 1;
+    } else if (argc > 1 && std::strcmp(argv[1], "bench") == 0) {
+        benchmark();
+    } else if (argc > 1 && std::strcmp(argv[1], "kernel") == 0) {
+        benchmarkKernel();
+    } else if (argc > 1 && std::strcmp(argv[1], "crossover") == 0) {
+        benchmarkCrossover();
+    } else if (argc > 1 && std::strcmp(argv[1], "slabs") == 0) {
+        benchmarkSlabs();
+    } else if (argc > 1 && std::strcmp(argv[1], "backends") == 0) {
+        benchmarkBackends();
+    } else if (argc > 1 && std::strcmp(argv[1], "sameX") == 0) {
+        benchmarkSameX();
+    } else if (argc > 1 && std::strcmp(argv[1], "predicates") == 0) {
+        benchmarkPredicates();
+    } else {
+        test();
+    }
     std::cout << "end" << std::endl;
-    return 0;
+    return status;
 }
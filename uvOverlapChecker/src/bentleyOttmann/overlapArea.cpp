@@ -0,0 +1,159 @@
+//
+//  overlapArea.cpp
+//  bentleyOttmann
+//
+
+#include "overlapArea.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct Point {
+    double x, y;
+};
+
+// A triangle clipped by at most 3 edges and 4 box sides has no more than
+// 10 corners
+const size_t maxCorners = 16;
+
+struct Polygon {
+    Point points[maxCorners];
+    size_t size;
+};
+
+// Keep the part of the polygon on the left side of a->b, or where
+// a * x + b * y + c >= 0 for the general form used below
+void clip(const Polygon& in, Polygon& out, double a, double b, double c)
+{
+    out.size = 0;
+    for (size_t i = 0; i < in.size; i++) {
+        const Point& p = in.points[i];
+        const Point& q = in.points[(i + 1) % in.size];
+        double dp = a * p.x + b * p.y + c;
+        double dq = a * q.x + b * q.y + c;
+        if (dp >= 0.0) {
+            out.points[out.size++] = p;
+        }
+        if ((dp >= 0.0) != (dq >= 0.0)) {
+            double t = dp / (dp - dq);
+            out.points[out.size++] = { p.x + t * (q.x - p.x), p.y + t * (q.y - p.y) };
+        }
+    }
+}
+
+double getArea(const Polygon& polygon)
+{
+    double area = 0.0;
+    for (size_t i = 0; i < polygon.size; i++) {
+        const Point& p = polygon.points[i];
+        const Point& q = polygon.points[(i + 1) % polygon.size];
+        area += p.x * q.y - q.x * p.y;
+    }
+    return 0.5 * std::abs(area);
+}
+
+struct Bounds {
+    float left, bottom, right, top;
+    size_t index;
+};
+
+void getBounds(const std::vector<TriangleBVH::Triangle>& triangles, size_t begin, size_t end,
+    float left, float bottom, float right, float top, std::vector<Bounds>& bounds)
+{
+    for (size_t i = begin; i < end; i++) {
+        const TriangleBVH::Triangle& t = triangles[i];
+        Bounds b = {
+            std::min(t.x0, std::min(t.x1, t.x2)),
+            std::min(t.y0, std::min(t.y1, t.y2)),
+            std::max(t.x0, std::max(t.x1, t.x2)),
+            std::max(t.y0, std::max(t.y1, t.y2)),
+            i
+        };
+        if (b.right < left || b.left > right || b.top < bottom || b.bottom > top) {
+            continue;
+        }
+        bounds.push_back(b);
+    }
+    std::sort(bounds.begin(), bounds.end(), [](const Bounds& a, const Bounds& b) { return a.left < b.left; });
+}
+
+} // namespace
+
+double overlapArea::getOverlap(const TriangleBVH::Triangle& a, const TriangleBVH::Triangle& b,
+    float left, float bottom, float right, float top)
+{
+    Polygon polygon = { { { a.x0, a.y0 }, { a.x1, a.y1 }, { a.x2, a.y2 } }, 3 };
+    Polygon clipped;
+
+    // Clip by the edges of b, turned counter clockwise first
+    Point corners[3] = { { b.x0, b.y0 }, { b.x1, b.y1 }, { b.x2, b.y2 } };
+    double winding = (corners[1].x - corners[0].x) * (corners[2].y - corners[0].y)
+        - (corners[1].y - corners[0].y) * (corners[2].x - corners[0].x);
+    if (winding == 0.0) {
+        return 0.0;
+    }
+    if (winding < 0.0) {
+        std::swap(corners[1], corners[2]);
+    }
+    for (size_t i = 0; i < 3; i++) {
+        const Point& p = corners[i];
+        const Point& q = corners[(i + 1) % 3];
+        // Left side of p->q
+        clip(polygon, clipped, p.y - q.y, q.x - p.x, p.x * q.y - q.x * p.y);
+        polygon = clipped;
+        if (polygon.size < 3) {
+            return 0.0;
+        }
+    }
+
+    // Then by the box
+    const double sides[4][3] = {
+        { 1.0, 0.0, -static_cast<double>(left) },
+        { -1.0, 0.0, static_cast<double>(right) },
+        { 0.0, 1.0, -static_cast<double>(bottom) },
+        { 0.0, -1.0, static_cast<double>(top) }
+    };
+    for (const auto& side : sides) {
+        clip(polygon, clipped, side[0], side[1], side[2]);
+        polygon = clipped;
+        if (polygon.size < 3) {
+            return 0.0;
+        }
+    }
+    return getArea(polygon);
+}
+
+double overlapArea::getOverlap(const std::vector<TriangleBVH::Triangle>& triangles,
+    size_t beginA, size_t endA, size_t beginB, size_t endB,
+    float left, float bottom, float right, float top)
+{
+    std::vector<Bounds> boundsA, boundsB;
+    getBounds(triangles, beginA, endA, left, bottom, right, top, boundsA);
+    getBounds(triangles, beginB, endB, left, bottom, right, top, boundsB);
+
+    // Sweep both lists by their left side. Each triangle is tested against
+    // the triangles of the other list starting before its right side
+    double area = 0.0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < boundsA.size() && j < boundsB.size()) {
+        bool isA = boundsA[i].left <= boundsB[j].left;
+        const Bounds& current = isA ? boundsA[i] : boundsB[j];
+        const std::vector<Bounds>& others = isA ? boundsB : boundsA;
+        for (size_t k = isA ? j : i; k < others.size() && others[k].left <= current.right; k++) {
+            const Bounds& other = others[k];
+            if (other.top < current.bottom || other.bottom > current.top) {
+                continue;
+            }
+            area += getOverlap(triangles[current.index], triangles[other.index], left, bottom, right, top);
+        }
+        if (isA) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return area;
+}
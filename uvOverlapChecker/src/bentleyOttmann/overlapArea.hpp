@@ -0,0 +1,29 @@
+//
+//  overlapArea.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include "triangleBvh.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Area covered by two sets of triangles at once, summed over every pair of
+// triangles of different sets. Each pair is clipped with Sutherland-Hodgman,
+// so triangles can be in any winding order. Triangles of a same set must not
+// overlap each other, like the ear clipped faces of a shell, or the area
+// they share is counted twice
+namespace overlapArea {
+
+// Area of the intersection of two triangles and the box
+double getOverlap(const TriangleBVH::Triangle& a, const TriangleBVH::Triangle& b,
+    float left, float bottom, float right, float top);
+
+// Area covered by both triangles [beginA, endA) and [beginB, endB) within
+// the box. Only pairs whose bounding boxes overlap inside the box are clipped
+double getOverlap(const std::vector<TriangleBVH::Triangle>& triangles,
+    size_t beginA, size_t endA, size_t beginB, size_t endB,
+    float left, float bottom, float right, float top);
+}
@@ -0,0 +1,120 @@
+//
+//  pairSet.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open addressing hash set of unordered index pairs. Memory is kept between
+// clear() calls, so once it has grown no more allocation happens
+class PairSet {
+public:
+    PairSet()
+        : numElements(0)
+    {
+    }
+
+    void clear()
+    {
+        std::fill(slots.begin(), slots.end(), emptyKey());
+        numElements = 0;
+    }
+
+    void reserve(size_t size)
+    {
+        size_t capacity = 16;
+        while (capacity < size * 2) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Returns false if the pair was already in the set
+    bool insert(size_t a, size_t b)
+    {
+        if ((numElements + 1) * 2 > slots.size()) {
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+        }
+        uint64_t key = makeKey(a, b);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == key) {
+                return false;
+            }
+            if (slots[i] == emptyKey()) {
+                slots[i] = key;
+                numElements++;
+                return true;
+            }
+        }
+    }
+
+    bool contains(size_t a, size_t b) const
+    {
+        if (slots.empty()) {
+            return false;
+        }
+        uint64_t key = makeKey(a, b);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == key) {
+                return true;
+            }
+            if (slots[i] == emptyKey()) {
+                return false;
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> slots;
+    size_t numElements;
+
+    static uint64_t emptyKey()
+    {
+        return ~static_cast<uint64_t>(0);
+    }
+
+    static uint64_t makeKey(size_t a, size_t b)
+    {
+        if (a > b) {
+            std::swap(a, b);
+        }
+        return (static_cast<uint64_t>(a) << 32) | static_cast<uint64_t>(b);
+    }
+
+    static size_t hash(uint64_t key)
+    {
+        // splitmix64 finalizer
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key);
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<uint64_t> oldSlots(capacity, emptyKey());
+        oldSlots.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (uint64_t key : oldSlots) {
+            if (key == emptyKey()) {
+                continue;
+            }
+            size_t i = hash(key) & mask;
+            while (slots[i] != emptyKey()) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = key;
+        }
+    }
+};
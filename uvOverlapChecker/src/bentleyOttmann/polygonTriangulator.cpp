@@ -0,0 +1,133 @@
+//
+//  polygonTriangulator.cpp
+//  bentleyOttmann
+//
+
+#include "polygonTriangulator.hpp"
+#include "lineUtils.hpp"
+
+void PolygonTriangulator::triangulate(const float* x, const float* y, const int* ids, size_t count)
+{
+    triangles.clear();
+    if (count < 3) {
+        return;
+    }
+    pointsX.resize(count);
+    pointsY.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        auto id = static_cast<unsigned int>(ids[i]);
+        pointsX[i] = x[id];
+        pointsY[i] = y[id];
+    }
+
+    if (count == 3) {
+        if (lineUtils::getOrientation(pointsX[0], pointsY[0], pointsX[1], pointsY[1], pointsX[2], pointsY[2]) != 0) {
+            addTriangle(0, 1, 2);
+        }
+        return;
+    }
+
+    // Ears are the corners turning the same way as the face, which the sign
+    // of its area tells. A face crossing itself like a bow tie can have no
+    // area at all, and then no side of it can be called the inside
+    double area = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        size_t next = i + 1 == count ? 0 : i + 1;
+        area += static_cast<double>(pointsX[i]) * pointsY[next] - static_cast<double>(pointsX[next]) * pointsY[i];
+    }
+    if (area == 0.0) {
+        return;
+    }
+    int winding = area > 0.0 ? 1 : -1;
+
+    polygon.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        polygon[i] = static_cast<unsigned int>(i);
+    }
+    size_t corner = 0;
+    size_t misses = 0;
+    while (polygon.size() > 3) {
+        if (misses == polygon.size()) {
+            // Every simple polygon has an ear, so this face crosses itself.
+            // Keep the fan triangles turning like the face, the others are
+            // outside of it for sure
+            for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                unsigned int a = polygon[0];
+                unsigned int b = polygon[i];
+                unsigned int c = polygon[i + 1];
+                if (lineUtils::getOrientation(pointsX[a], pointsY[a], pointsX[b], pointsY[b], pointsX[c], pointsY[c]) == winding) {
+                    addTriangle(a, b, c);
+                }
+            }
+            return;
+        }
+        if (!isEar(corner, winding)) {
+            corner = corner + 1 == polygon.size() ? 0 : corner + 1;
+            misses++;
+            continue;
+        }
+        unsigned int a = polygon[corner == 0 ? polygon.size() - 1 : corner - 1];
+        unsigned int b = polygon[corner];
+        unsigned int c = polygon[corner + 1 == polygon.size() ? 0 : corner + 1];
+        if (lineUtils::getOrientation(pointsX[a], pointsY[a], pointsX[b], pointsY[b], pointsX[c], pointsY[c]) != 0) {
+            addTriangle(a, b, c);
+        }
+        polygon.erase(polygon.begin() + static_cast<std::ptrdiff_t>(corner));
+        if (corner == polygon.size()) {
+            corner = 0;
+        }
+        misses = 0;
+    }
+    unsigned int a = polygon[0];
+    unsigned int b = polygon[1];
+    unsigned int c = polygon[2];
+    if (lineUtils::getOrientation(pointsX[a], pointsY[a], pointsX[b], pointsY[b], pointsX[c], pointsY[c]) == winding) {
+        addTriangle(a, b, c);
+    }
+}
+
+bool PolygonTriangulator::isEar(size_t corner, int winding) const
+{
+    size_t size = polygon.size();
+    size_t previous = corner == 0 ? size - 1 : corner - 1;
+    size_t next = corner + 1 == size ? 0 : corner + 1;
+    float ax = pointsX[polygon[previous]];
+    float ay = pointsY[polygon[previous]];
+    float bx = pointsX[polygon[corner]];
+    float by = pointsY[polygon[corner]];
+    float cx = pointsX[polygon[next]];
+    float cy = pointsY[polygon[next]];
+    int turn = lineUtils::getOrientation(ax, ay, bx, by, cx, cy);
+    if (turn == -winding) {
+        return false;
+    }
+    // Clipping a corner on a line removes no area
+    if (turn == 0) {
+        return true;
+    }
+
+    // No other point may be inside or on the border of the ear. Points at
+    // one of its corners are where the face touches itself and don't count
+    for (size_t i = 0; i < size; i++) {
+        if (i == previous || i == corner || i == next) {
+            continue;
+        }
+        float px = pointsX[polygon[i]];
+        float py = pointsY[polygon[i]];
+        if ((px == ax && py == ay) || (px == bx && py == by) || (px == cx && py == cy)) {
+            continue;
+        }
+        if (lineUtils::getOrientation(ax, ay, bx, by, px, py) != -winding
+            && lineUtils::getOrientation(bx, by, cx, cy, px, py) != -winding
+            && lineUtils::getOrientation(cx, cy, ax, ay, px, py) != -winding) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PolygonTriangulator::addTriangle(unsigned int a, unsigned int b, unsigned int c)
+{
+    TriangleBVH::Triangle triangle = { pointsX[a], pointsY[a], pointsX[b], pointsY[b], pointsX[c], pointsY[c] };
+    triangles.push_back(triangle);
+}
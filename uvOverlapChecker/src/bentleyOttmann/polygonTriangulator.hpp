@@ -0,0 +1,33 @@
+//
+//  polygonTriangulator.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include "triangleBvh.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Splits faces into triangles by ear clipping. Unlike a fan from the first
+// point, the triangles of a concave face stay inside of it and don't overlap
+// each other, so their areas sum up to the area of the face. Buffers are
+// kept between faces
+class PolygonTriangulator {
+public:
+    // Triangulate the face of count points (x[ids[i]], y[ids[i]]) into
+    // triangles. Triangles of zero area are left out
+    void triangulate(const float* x, const float* y, const int* ids, size_t count);
+
+    std::vector<TriangleBVH::Triangle> triangles;
+
+private:
+    std::vector<float> pointsX;
+    std::vector<float> pointsY;
+    // Points of the face which haven't been clipped yet
+    std::vector<unsigned int> polygon;
+
+    bool isEar(size_t corner, int winding) const;
+    void addTriangle(unsigned int a, unsigned int b, unsigned int c);
+};
@@ -0,0 +1,98 @@
+//
+//  segmentStore.cpp
+//  bentleyOttmann
+//
+
+#include "segmentStore.hpp"
+#include "crossingKernel.hpp"
+#include "lineUtils.hpp"
+#include <utility>
+
+void SegmentStore::reserve(size_t size)
+{
+    x0.reserve(size);
+    y0.reserve(size);
+    x1.reserve(size);
+    y1.reserve(size);
+    uvA.reserve(size);
+    uvB.reserve(size);
+    meshId.reserve(size);
+}
+
+void SegmentStore::resize(size_t size)
+{
+    x0.resize(size);
+    y0.resize(size);
+    x1.resize(size);
+    y1.resize(size);
+    uvA.resize(size);
+    uvB.resize(size);
+    meshId.resize(size);
+}
+
+void SegmentStore::clear()
+{
+    x0.clear();
+    y0.clear();
+    x1.clear();
+    y1.clear();
+    uvA.clear();
+    uvB.clear();
+    meshId.clear();
+}
+
+void SegmentStore::add(float u1, float v1, int uv1, float u2, float v2, int uv2, unsigned int mesh)
+{
+    resize(size() + 1);
+    set(size() - 1, u1, v1, uv1, u2, v2, uv2, mesh);
+}
+
+void SegmentStore::set(size_t index, float u1, float v1, int uv1, float u2, float v2, int uv2, unsigned int mesh)
+{
+    if (u2 < u1 || (u2 == u1 && v2 < v1)) {
+        std::swap(u1, u2);
+        std::swap(v1, v2);
+        std::swap(uv1, uv2);
+    }
+    x0[index] = u1;
+    y0[index] = v1;
+    x1[index] = u2;
+    y1[index] = v2;
+    uvA[index] = uv1;
+    uvB[index] = uv2;
+    meshId[index] = mesh;
+}
+
+void SegmentStore::append(const SegmentStore& other)
+{
+    x0.insert(x0.end(), other.x0.begin(), other.x0.end());
+    y0.insert(y0.end(), other.y0.begin(), other.y0.end());
+    x1.insert(x1.end(), other.x1.begin(), other.x1.end());
+    y1.insert(y1.end(), other.y1.begin(), other.y1.end());
+    uvA.insert(uvA.end(), other.uvA.begin(), other.uvA.end());
+    uvB.insert(uvB.end(), other.uvB.begin(), other.uvB.end());
+    meshId.insert(meshId.end(), other.meshId.begin(), other.meshId.end());
+}
+
+bool SegmentStore::isCrossing(size_t indexA, size_t indexB) const
+{
+    return lineUtils::isCrossing(
+        x0[indexA], y0[indexA], x1[indexA], y1[indexA],
+        x0[indexB], y0[indexB], x1[indexB], y1[indexB]);
+}
+
+void SegmentStore::findCrossings(size_t index, size_t begin, size_t end, uint32_t* masks) const
+{
+    crossingKernel::findCrossings(
+        x0[index], y0[index], x1[index], y1[index],
+        &x0[begin], &y0[begin], &x1[begin], &y1[begin],
+        end - begin, masks);
+}
+
+bool SegmentStore::getIntersectionPoint(size_t indexA, size_t indexB, float& x, float& y) const
+{
+    return lineUtils::getIntersectionPoint(
+        x0[indexA], y0[indexA], x1[indexA], y1[indexA],
+        x0[indexB], y0[indexB], x1[indexB], y1[indexB],
+        x, y);
+}
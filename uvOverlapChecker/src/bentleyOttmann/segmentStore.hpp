@@ -0,0 +1,47 @@
+//
+//  segmentStore.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure of arrays holding UV edges. Shells and the sweep refer to edges
+// by their index in the store, so nothing is copied per shell or shell pair.
+// The begin point (x0, y0) of an edge is always the smaller one in (x, y) order
+class SegmentStore {
+public:
+    std::vector<float> x0, y0, x1, y1;
+    std::vector<int> uvA, uvB;
+    std::vector<unsigned int> meshId;
+
+    size_t size() const
+    {
+        return x0.size();
+    }
+
+    void reserve(size_t size);
+    void resize(size_t size);
+    void clear();
+    void add(float u1, float v1, int uv1, float u2, float v2, int uv2, unsigned int mesh);
+    void set(size_t index, float u1, float v1, int uv1, float u2, float v2, int uv2, unsigned int mesh);
+    void append(const SegmentStore& other);
+
+    bool isVertical(size_t index) const
+    {
+        return x0[index] == x1[index];
+    }
+
+    bool isCrossing(size_t indexA, size_t indexB) const;
+
+    // Test the edge at index against edges [begin, end) with the SIMD kernel.
+    // Bit i of the masks is set if it crosses edge begin + i, masks must hold
+    // crossingKernel::getMaskSize(end - begin) words
+    void findCrossings(size_t index, size_t begin, size_t end, uint32_t* masks) const;
+
+    // Returns false if the edges are parallel, and so don't meet at a single point
+    bool getIntersectionPoint(size_t indexA, size_t indexB, float& x, float& y) const;
+};
@@ -0,0 +1,112 @@
+//
+//  triangleBvh.cpp
+//  bentleyOttmann
+//
+
+#include "triangleBvh.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const unsigned int maxLeafTriangles = 4;
+
+float getCenterX(const TriangleBVH::Triangle& triangle)
+{
+    return triangle.x0 + triangle.x1 + triangle.x2;
+}
+
+float getCenterY(const TriangleBVH::Triangle& triangle)
+{
+    return triangle.y0 + triangle.y1 + triangle.y2;
+}
+
+} // namespace
+
+void TriangleBVH::build(const Triangle* begin, const Triangle* end)
+{
+    triangles.assign(begin, end);
+    nodes.clear();
+    if (triangles.empty()) {
+        return;
+    }
+    nodes.reserve(2 * triangles.size() / maxLeafTriangles + 1);
+    buildNode(0, static_cast<unsigned int>(triangles.size()));
+}
+
+unsigned int TriangleBVH::buildNode(unsigned int begin, unsigned int end)
+{
+    auto index = static_cast<unsigned int>(nodes.size());
+    Node node;
+    node.left = node.right = triangles[begin].x0;
+    node.bottom = node.top = triangles[begin].y0;
+    for (unsigned int i = begin; i < end; i++) {
+        const Triangle& t = triangles[i];
+        node.left = std::min(node.left, std::min(t.x0, std::min(t.x1, t.x2)));
+        node.right = std::max(node.right, std::max(t.x0, std::max(t.x1, t.x2)));
+        node.bottom = std::min(node.bottom, std::min(t.y0, std::min(t.y1, t.y2)));
+        node.top = std::max(node.top, std::max(t.y0, std::max(t.y1, t.y2)));
+    }
+    node.begin = begin;
+    node.end = end;
+    node.secondChild = 0;
+    nodes.push_back(node);
+
+    if (end - begin <= maxLeafTriangles) {
+        return index;
+    }
+
+    // Split at the median triangle along the longer side of the box
+    unsigned int middle = begin + (end - begin) / 2;
+    bool isWide = node.right - node.left > node.top - node.bottom;
+    std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+        [isWide](const Triangle& a, const Triangle& b) {
+            return isWide ? getCenterX(a) < getCenterX(b) : getCenterY(a) < getCenterY(b);
+        });
+
+    buildNode(begin, middle);
+    unsigned int secondChild = buildNode(middle, end);
+    nodes[index].secondChild = secondChild;
+    return index;
+}
+
+bool TriangleBVH::isInside(const Triangle& triangle, float x, float y)
+{
+    // Same side of all three edges, either side so that flipped faces work too
+    float d0 = (triangle.x1 - triangle.x0) * (y - triangle.y0) - (triangle.y1 - triangle.y0) * (x - triangle.x0);
+    float d1 = (triangle.x2 - triangle.x1) * (y - triangle.y1) - (triangle.y2 - triangle.y1) * (x - triangle.x1);
+    float d2 = (triangle.x0 - triangle.x2) * (y - triangle.y2) - (triangle.y0 - triangle.y2) * (x - triangle.x2);
+    bool hasNegative = d0 < 0.0F || d1 < 0.0F || d2 < 0.0F;
+    bool hasPositive = d0 > 0.0F || d1 > 0.0F || d2 > 0.0F;
+    return !(hasNegative && hasPositive);
+}
+
+bool TriangleBVH::contains(float x, float y) const
+{
+    if (nodes.empty()) {
+        return false;
+    }
+
+    unsigned int stack[64];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize != 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (x < node.left || x > node.right || y < node.bottom || y > node.top) {
+            continue;
+        }
+        if (node.secondChild == 0) {
+            for (unsigned int i = node.begin; i < node.end; i++) {
+                if (isInside(triangles[i], x, y)) {
+                    return true;
+                }
+            }
+            continue;
+        }
+        // Median splits keep the depth at about log2(n), far below the stack size
+        auto firstChild = static_cast<unsigned int>(&node - nodes.data()) + 1;
+        stack[stackSize++] = node.secondChild;
+        stack[stackSize++] = firstChild;
+    }
+    return false;
+}
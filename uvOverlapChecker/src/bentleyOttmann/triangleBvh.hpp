@@ -0,0 +1,46 @@
+//
+//  triangleBvh.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Bounding volume hierarchy over the triangulated faces of a UV shell. Tells
+// whether a point lies on any of the triangles, visiting about log(n) nodes
+// instead of every triangle
+class TriangleBVH {
+public:
+    struct Triangle {
+        float x0, y0, x1, y1, x2, y2;
+    };
+
+    // Copy triangles [begin, end) and build the tree over them
+    void build(const Triangle* begin, const Triangle* end);
+
+    // True if (x, y) is inside or on the border of any triangle, whatever
+    // the winding of the triangle is
+    bool contains(float x, float y) const;
+
+    size_t size() const
+    {
+        return triangles.size();
+    }
+
+private:
+    // Leaves hold triangles [begin, end). The first child of an inner node
+    // directly follows it, the second one is at secondChild
+    struct Node {
+        float left, bottom, right, top;
+        unsigned int begin, end;
+        unsigned int secondChild;
+    };
+
+    std::vector<Triangle> triangles;
+    std::vector<Node> nodes;
+
+    unsigned int buildNode(unsigned int begin, unsigned int end);
+    static bool isInside(const Triangle& triangle, float x, float y);
+};
@@ -0,0 +1,208 @@
+//
+//  uniformGrid.cpp
+//  bentleyOttmann
+//
+
+#include "uniformGrid.hpp"
+#include "crossingKernel.hpp"
+#include "../../../include/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+UniformGrid::UniformGrid(const SegmentStore& store)
+    : store(store)
+{
+}
+
+void UniformGrid::addSegments(size_t begin, size_t end)
+{
+    edges.reserve(edges.size() + end - begin);
+    for (size_t i = begin; i < end; i++) {
+        edges.emplace_back(static_cast<unsigned int>(i));
+    }
+}
+
+size_t UniformGrid::getCellX(float x) const
+{
+    float cell = (x - left) / cellSize;
+    if (!(cell > 0.0F)) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(cell), numCellsX - 1);
+}
+
+size_t UniformGrid::getCellY(float y) const
+{
+    float cell = (y - bottom) / cellSize;
+    if (!(cell > 0.0F)) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(cell), numCellsY - 1);
+}
+
+void UniformGrid::build()
+{
+    size_t numEdges = edges.size();
+    float right = store.x1[edges[0]];
+    float top = std::max(store.y0[edges[0]], store.y1[edges[0]]);
+    left = store.x0[edges[0]];
+    bottom = std::min(store.y0[edges[0]], store.y1[edges[0]]);
+    double extentSum = 0.0;
+    for (unsigned int edge : edges) {
+        // Begin of each edge is always on the left side
+        float width = store.x1[edge] - store.x0[edge];
+        float height = std::fabs(store.y1[edge] - store.y0[edge]);
+        extentSum += static_cast<double>(std::max(width, height));
+        left = std::min(left, store.x0[edge]);
+        right = std::max(right, store.x1[edge]);
+        bottom = std::min(bottom, std::min(store.y0[edge], store.y1[edge]));
+        top = std::max(top, std::max(store.y0[edge], store.y1[edge]));
+    }
+
+    // Cells of about twice the average edge size keep most edges in a few
+    // cells. Sparse layouts would make a huge grid of empty cells though, so
+    // limit the grid to a couple of cells per edge
+    double width = static_cast<double>(right) - static_cast<double>(left);
+    double height = static_cast<double>(top) - static_cast<double>(bottom);
+    double maxCells = 2.0 * static_cast<double>(numEdges) + 16.0;
+    double size = 2.0 * extentSum / static_cast<double>(numEdges);
+    if (!(size > 0.0) || (width / size + 1.0) * (height / size + 1.0) > maxCells) {
+        size = std::max(std::sqrt(width * height / maxCells), std::max(width, height) / maxCells);
+    }
+    if (!(size > 0.0)) {
+        size = 1.0;
+    }
+    cellSize = static_cast<float>(size);
+    numCellsX = static_cast<size_t>(width / size) + 1;
+    numCellsY = static_cast<size_t>(height / size) + 1;
+
+    // Count the edges of each cell, then fill them in, both going through
+    // every cell touched by the bounding box of an edge
+    cellOffsets.assign(numCellsX * numCellsY + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned int edge : edges) {
+            size_t beginX = getCellX(store.x0[edge]);
+            size_t endX = getCellX(store.x1[edge]);
+            size_t beginY = getCellY(std::min(store.y0[edge], store.y1[edge]));
+            size_t endY = getCellY(std::max(store.y0[edge], store.y1[edge]));
+            for (size_t y = beginY; y <= endY; y++) {
+                for (size_t x = beginX; x <= endX; x++) {
+                    size_t cell = y * numCellsX + x;
+                    if (pass == 0) {
+                        cellOffsets[cell + 1]++;
+                    } else {
+                        cellEdges[cellOffsets[cell]++] = edge;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            for (size_t i = 1; i < cellOffsets.size(); i++) {
+                cellOffsets[i] += cellOffsets[i - 1];
+            }
+            cellEdges.resize(cellOffsets.back());
+        } else {
+            // Filling moved each offset to the begin of the next cell
+            for (size_t i = cellOffsets.size() - 1; i > 0; i--) {
+                cellOffsets[i] = cellOffsets[i - 1];
+            }
+            cellOffsets[0] = 0;
+        }
+    }
+}
+
+void UniformGrid::checkCells(size_t beginCell, size_t endCell, std::vector<unsigned int>& result) const
+{
+    std::vector<float> x0, y0, x1, y1, bottoms;
+    std::vector<uint32_t> masks;
+
+    for (size_t cell = beginCell; cell < endCell; cell++) {
+        size_t begin = cellOffsets[cell];
+        size_t numCellEdges = cellOffsets[cell + 1] - begin;
+        if (numCellEdges < 2) {
+            continue;
+        }
+
+        // Gather the cell's edges so the kernel reads them contiguously
+        x0.resize(numCellEdges);
+        y0.resize(numCellEdges);
+        x1.resize(numCellEdges);
+        y1.resize(numCellEdges);
+        bottoms.resize(numCellEdges);
+        for (size_t i = 0; i < numCellEdges; i++) {
+            unsigned int edge = cellEdges[begin + i];
+            x0[i] = store.x0[edge];
+            y0[i] = store.y0[edge];
+            x1[i] = store.x1[edge];
+            y1[i] = store.y1[edge];
+            bottoms[i] = std::min(y0[i], y1[i]);
+        }
+        masks.resize(crossingKernel::getMaskSize(numCellEdges));
+
+        size_t cellX = cell % numCellsX;
+        size_t cellY = cell / numCellsX;
+        for (size_t i = 0; i + 1 < numCellEdges; i++) {
+            size_t first = i + 1;
+            crossingKernel::findCrossings(x0[i], y0[i], x1[i], y1[i],
+                &x0[first], &y0[first], &x1[first], &y1[first],
+                numCellEdges - first, masks.data());
+
+            size_t numWords = crossingKernel::getMaskSize(numCellEdges - first);
+            for (size_t word = 0; word < numWords; word++) {
+                uint32_t mask = masks[word];
+                for (unsigned int bit = 0; mask != 0; bit++, mask >>= 1) {
+                    if ((mask & 1U) == 0) {
+                        continue;
+                    }
+                    // Pairs sharing several cells are reported by the cell
+                    // holding the lower left corner of their bounding boxes'
+                    // overlap, which both edges are binned into
+                    size_t j = first + word * 32 + bit;
+                    if (getCellX(std::max(x0[i], x0[j])) != cellX
+                        || getCellY(std::max(bottoms[i], bottoms[j])) != cellY) {
+                        continue;
+                    }
+                    result.emplace_back(cellEdges[begin + i]);
+                    result.emplace_back(cellEdges[begin + j]);
+                }
+            }
+        }
+    }
+}
+
+void UniformGrid::check(std::vector<unsigned int>& result, unsigned int numThreads)
+{
+    if (edges.size() < 2) {
+        return;
+    }
+    build();
+
+    size_t numCells = getNumCells();
+    if (numThreads <= 1) {
+        checkCells(0, numCells, result);
+        return;
+    }
+
+    // Workers take chunks of cells until none is left, each with its own
+    // result which is appended at the end
+    const size_t chunkSize = 256;
+    std::atomic<size_t> nextChunk(0);
+    std::vector<std::future<std::vector<unsigned int> > > workerResults;
+    ThreadPool pool(numThreads);
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workerResults.push_back(pool.enqueue([this, numCells, chunkSize, &nextChunk]() {
+            std::vector<unsigned int> workerResult;
+            for (size_t chunk = nextChunk++; chunk * chunkSize < numCells; chunk = nextChunk++) {
+                checkCells(chunk * chunkSize, std::min((chunk + 1) * chunkSize, numCells), workerResult);
+            }
+            return workerResult;
+        }));
+    }
+    for (auto& workerResult : workerResults) {
+        std::vector<unsigned int> cellResult = workerResult.get();
+        result.insert(result.end(), cellResult.begin(), cellResult.end());
+    }
+}
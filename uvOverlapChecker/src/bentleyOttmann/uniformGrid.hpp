@@ -0,0 +1,54 @@
+//
+//  uniformGrid.hpp
+//  bentleyOttmann
+//
+
+#pragma once
+
+#include "segmentStore.hpp"
+
+#include <vector>
+
+// Alternative to BentleyOttmann which bins edges into a uniform grid and
+// tests pairs of edges sharing a cell. The cell size is derived from the
+// average edge size, so with evenly dense layouts every cell holds a handful
+// of edges. Cells are independent and checked on several threads
+class UniformGrid {
+public:
+    explicit UniformGrid(const SegmentStore& store);
+
+    // Add edges [begin, end) of the store to the check
+    void addSegments(size_t begin, size_t end);
+
+    // Fill result with store indices of crossing edges, two per crossing
+    void check(std::vector<unsigned int>& result, unsigned int numThreads = 1);
+
+    float getCellSize() const
+    {
+        return cellSize;
+    }
+
+    size_t getNumCells() const
+    {
+        return numCellsX * numCellsY;
+    }
+
+private:
+    const SegmentStore& store;
+    std::vector<unsigned int> edges;
+
+    float left{};
+    float bottom{};
+    float cellSize{};
+    size_t numCellsX{};
+    size_t numCellsY{};
+
+    // Edges of cell i are cellEdges[cellOffsets[i], cellOffsets[i + 1])
+    std::vector<size_t> cellOffsets;
+    std::vector<unsigned int> cellEdges;
+
+    void build();
+    size_t getCellX(float x) const;
+    size_t getCellY(float y) const;
+    void checkCells(size_t beginCell, size_t endCell, std::vector<unsigned int>& result) const;
+};
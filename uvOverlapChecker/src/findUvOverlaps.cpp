@@ -1,36 +1,45 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
 #include <unordered_set>
 #include "findUvOverlaps.hpp"
+#include "bentleyOttmann/polygonTriangulator.hpp"
+#include "../../include/ThreadPool.hpp"
 #include <maya/MArgDatabase.h>
 #include <maya/MDagPath.h>
 #include <maya/MFloatArray.h>
+#include <maya/MFnDependencyNode.h>
 #include <maya/MFnMesh.h>
 #include <maya/MFnPlugin.h>
 #include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MObjectArray.h>
 #include <maya/MTimer.h>
 
 static const char* const pluginCommandName = "findUvOverlaps";
 static const char* const pluginVersion = "1.8.20";
 static const char* const pluginAuthor = "Michitaka Inoue";
 
-void UVShell::initAABB()
+void UVShell::initAABB(const SegmentStore& store)
 {
-    std::vector<float> uVector;
-    std::vector<float> vVector;
-    for (auto & line : this->lines) {
-        uVector.emplace_back(line.begin.x);
-        uVector.emplace_back(line.end.x);
-        vVector.emplace_back(line.begin.y);
-        vVector.emplace_back(line.end.y);
-    }
-    this->left = *std::min_element(uVector.begin(), uVector.end());
-    this->right = *std::max_element(uVector.begin(), uVector.end());
-    this->bottom = *std::min_element(vVector.begin(), vVector.end());
-    this->top = *std::max_element(vVector.begin(), vVector.end());
+    this->left = store.x0[begin];
+    this->right = store.x1[begin];
+    this->bottom = std::min(store.y0[begin], store.y1[begin]);
+    this->top = std::max(store.y0[begin], store.y1[begin]);
+
+    // Begin of each edge is always on the left side
+    for (size_t i = begin + 1; i < end; i++) {
+        this->left = std::min(this->left, store.x0[i]);
+        this->right = std::max(this->right, store.x1[i]);
+        this->bottom = std::min(this->bottom, std::min(store.y0[i], store.y1[i]));
+        this->top = std::max(this->top, std::max(store.y0[i], store.y1[i]));
+    }
 }
 
 bool UVShell::operator*(const UVShell& other) const
@@ -50,17 +59,218 @@ bool UVShell::operator*(const UVShell& other) const
     return true;
 }
 
-UVShell UVShell::operator&&(const UVShell& other) const
+namespace {
+
+// UDIM tile row or column of a uv coordinate. Values far outside of the
+// usual 0-10 range are clamped so that they can't overflow
+int getTileIndex(float value)
+{
+    const float limit = 1048576.0F;
+    if (!(value > -limit)) {
+        return -static_cast<int>(limit);
+    }
+    if (!(value < limit)) {
+        return static_cast<int>(limit);
+    }
+    return static_cast<int>(std::floor(value));
+}
+
+int64_t getTileKey(int u, int v)
+{
+    // Tile indices are within +-2^20, so keys of different tiles never collide
+    return static_cast<int64_t>(u) * 4194304 + v;
+}
+
+// Name of a tile in results. UDIM number for the usual 10 columns, tiles
+// outside of them are named after their 1 based column and row instead
+std::string getTileName(int u, int v)
+{
+    if (u >= 0 && u < 10 && v >= 0 && v < 100000) {
+        return std::to_string(1001 + u + 10 * v);
+    }
+    return "u" + std::to_string(static_cast<int64_t>(u) + 1) + "_v" + std::to_string(static_cast<int64_t>(v) + 1);
+}
+
+// Tile of an edge cut at the tile borders, the one of its middle point
+void getSegmentTile(const SegmentStore& store, size_t index, int& u, int& v)
+{
+    u = getTileIndex(0.5F * (store.x0[index] + store.x1[index]));
+    v = getTileIndex(0.5F * (store.y0[index] + store.y1[index]));
+}
+
+// Cut every edge at the tile borders it crosses, then make one shell of the
+// pieces of each tile a shell touches. Pieces keep the uv indices of their
+// edge. Tile shells keep the triangles of the whole shell
+void splitShellsAtTileBorders(const SegmentStore& segments, std::vector<UVShell>& shells, SegmentStore& tileSegments)
+{
+    // Edges crossing more borders than this are most likely broken UVs far
+    // away from any tile, they are kept whole in the tile of their middle
+    const int maxBorders = 1024;
+
+    struct Cut {
+        float t;
+        bool isVertical;
+        float border;
+    };
+    struct Piece {
+        int64_t tile;
+        int u, v;
+        float u0, v0, u1, v1;
+        int uvA, uvB;
+        unsigned int meshId;
+    };
+    std::vector<Cut> cuts;
+    std::vector<Piece> pieces;
+    std::vector<UVShell> tileShells;
+    tileSegments.clear();
+    tileSegments.reserve(segments.size());
+
+    for (const UVShell& shell : shells) {
+        pieces.clear();
+        for (size_t i = shell.begin; i < shell.end; i++) {
+            float x0 = segments.x0[i];
+            float y0 = segments.y0[i];
+            float x1 = segments.x1[i];
+            float y1 = segments.y1[i];
+            int beginU = getTileIndex(x0);
+            int endU = getTileIndex(x1);
+            int beginV = getTileIndex(std::min(y0, y1));
+            int endV = getTileIndex(std::max(y0, y1));
+
+            cuts.clear();
+            cuts.push_back({ 0.0F, false, 0.0F });
+            if ((endU - beginU) + (endV - beginV) <= maxBorders) {
+                for (int u = beginU + 1; u <= endU; u++) {
+                    auto border = static_cast<float>(u);
+                    cuts.push_back({ (border - x0) / (x1 - x0), true, border });
+                }
+                for (int v = beginV + 1; v <= endV; v++) {
+                    auto border = static_cast<float>(v);
+                    cuts.push_back({ (border - y0) / (y1 - y0), false, border });
+                }
+            }
+            cuts.push_back({ 1.0F, false, 0.0F });
+            std::sort(cuts.begin() + 1, cuts.end() - 1, [](const Cut& a, const Cut& b) { return a.t < b.t; });
+
+            // Points on a border are put exactly on it, so that pieces don't
+            // stick out of their tile
+            float pieceU0 = x0;
+            float pieceV0 = y0;
+            for (size_t cut = 1; cut < cuts.size(); cut++) {
+                float pieceU1 = x1;
+                float pieceV1 = y1;
+                if (cut + 1 < cuts.size()) {
+                    pieceU1 = cuts[cut].isVertical ? cuts[cut].border : x0 + cuts[cut].t * (x1 - x0);
+                    pieceV1 = cuts[cut].isVertical ? y0 + cuts[cut].t * (y1 - y0) : cuts[cut].border;
+                }
+                if (pieceU0 != pieceU1 || pieceV0 != pieceV1) {
+                    Piece piece;
+                    piece.u = getTileIndex(0.5F * (pieceU0 + pieceU1));
+                    piece.v = getTileIndex(0.5F * (pieceV0 + pieceV1));
+                    piece.tile = getTileKey(piece.u, piece.v);
+                    piece.u0 = pieceU0;
+                    piece.v0 = pieceV0;
+                    piece.u1 = pieceU1;
+                    piece.v1 = pieceV1;
+                    piece.uvA = segments.uvA[i];
+                    piece.uvB = segments.uvB[i];
+                    piece.meshId = segments.meshId[i];
+                    pieces.push_back(piece);
+                }
+                pieceU0 = pieceU1;
+                pieceV0 = pieceV1;
+            }
+        }
+
+        std::stable_sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.tile < b.tile; });
+        for (size_t i = 0; i < pieces.size(); i++) {
+            const Piece& piece = pieces[i];
+            if (i == 0 || piece.tile != pieces[i - 1].tile) {
+                UVShell tileShell = shell;
+                tileShell.begin = tileSegments.size();
+                tileShell.tileU = piece.u;
+                tileShell.tileV = piece.v;
+                tileShells.push_back(tileShell);
+            }
+            tileSegments.add(piece.u0, piece.v0, piece.uvA, piece.u1, piece.v1, piece.uvB, piece.meshId);
+            tileShells.back().end = tileSegments.size();
+        }
+    }
+    shells.swap(tileShells);
+}
+
+// Sort keys and drop duplicates. Chunks of the keys are sorted on several
+// threads, then merged pairwise, also in parallel
+void sortUnique(std::vector<uint64_t>& keys, unsigned int numThreads)
 {
-    std::vector<LineSegment> lineVector = this->lines;
-    lineVector.insert(lineVector.end(), other.lines.begin(), other.lines.end());
-    UVShell shell;
-    shell.lines = lineVector;
-    return shell;
+    const size_t minChunkSize = 65536;
+    size_t numChunks = std::min(static_cast<size_t>(numThreads), keys.size() / minChunkSize);
+    if (numChunks < 2) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return;
+    }
+
+    std::vector<size_t> borders(numChunks + 1);
+    for (size_t i = 0; i <= numChunks; i++) {
+        borders[i] = keys.size() * i / numChunks;
+    }
+    ThreadPool pool(numChunks);
+    std::vector<std::future<void> > tasks;
+    for (size_t i = 0; i < numChunks; i++) {
+        tasks.push_back(pool.enqueue([&keys, &borders, i]() {
+            std::sort(keys.begin() + static_cast<std::ptrdiff_t>(borders[i]), keys.begin() + static_cast<std::ptrdiff_t>(borders[i + 1]));
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+    for (size_t width = 1; width < numChunks; width *= 2) {
+        tasks.clear();
+        for (size_t i = 0; i + width < numChunks; i += 2 * width) {
+            size_t last = std::min(i + 2 * width, numChunks);
+            tasks.push_back(pool.enqueue([&keys, &borders, i, width, last]() {
+                std::inplace_merge(keys.begin() + static_cast<std::ptrdiff_t>(borders[i]),
+                    keys.begin() + static_cast<std::ptrdiff_t>(borders[i + width]),
+                    keys.begin() + static_cast<std::ptrdiff_t>(borders[last]));
+            }));
+        }
+        for (auto& task : tasks) {
+            task.get();
+        }
+    }
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+// True if the sorted shading group ids of the shells have one in common
+bool shareShadingGroup(const UVShell& shellA, const UVShell& shellB)
+{
+    auto a = shellA.shadingGroups.begin();
+    auto b = shellB.shadingGroups.begin();
+    while (a != shellA.shadingGroups.end() && b != shellB.shadingGroups.end()) {
+        if (*a == *b) {
+            return true;
+        }
+        if (*a < *b) {
+            ++a;
+        } else {
+            ++b;
+        }
+    }
+    return false;
 }
 
+} // namespace
+
 FindUvOverlaps::FindUvOverlaps()
-    : verbose(false) {}
+    : verbose(false)
+    , anyMode(false)
+    , udimMode(false)
+    , shadingGroupMode(false)
+    , cacheMode(false)
+    , areaMode(false)
+    , numThreads(1)
+    , bruteForceThreshold(0) {}
 
 FindUvOverlaps::~FindUvOverlaps() = default;
 
@@ -74,36 +284,84 @@ MSyntax FindUvOverlaps::newSyntax()
     MSyntax syntax;
     syntax.addFlag("-v", "-verbose", MSyntax::kBoolean);
     syntax.addFlag("-set", "-uvSet", MSyntax::kString);
+    syntax.addFlag("-bft", "-bruteForceThreshold", MSyntax::kUnsigned);
+    syntax.addFlag("-t", "-threads", MSyntax::kUnsigned);
+    syntax.addFlag("-eng", "-engine", MSyntax::kString);
+    syntax.addFlag("-any", "-anyOverlap", MSyntax::kBoolean);
+    syntax.addFlag("-udim", "-udimTiles", MSyntax::kBoolean);
+    syntax.addFlag("-sg", "-byShadingGroup", MSyntax::kBoolean);
+    syntax.addFlag("-c", "-cache", MSyntax::kBoolean);
+    syntax.addFlag("-ar", "-overlapArea", MSyntax::kBoolean);
     return syntax;
 }
 
-void FindUvOverlaps::btoCheck(UVShell& shell)
+void FindUvOverlaps::btoCheck(const UVCheck& check, std::vector<unsigned int>& result)
 {
-    std::vector<LineSegment> result;
-    BentleyOttmann b(shell.lines);
+    const UVShell& shellA = *check.shellA;
+    const UVShell* shellB = check.shellB;
+
+    if (check.numEdges < bruteForceThreshold) {
+        // Edges within each shell of a pair are checked by the shell's own
+        // task, so only edges of different shells need to be tested here
+        if (shellB == nullptr) {
+            bruteForce::check(segments, shellA.begin, shellA.end, result);
+        } else {
+            bruteForce::check(segments, shellA.begin, shellA.end, shellB->begin, shellB->end, result);
+        }
+        return;
+    }
+
+    BentleyOttmann b(segments);
+    if (anyMode) {
+        b.setStopAtFirstCrossing(true);
+        b.setCancelCallback([this, &check]() { return isResolved(check); });
+    }
+    if (shellB == nullptr) {
+        const float infinity = std::numeric_limits<float>::infinity();
+        b.addSegments(shellA.begin, shellA.end, BentleyOttmann::RED,
+            check.slabLeft, -infinity, check.slabRight, infinity);
+        b.setSlab(check.slabLeft, check.slabRight);
+    } else {
+        // Crossings within each shell are found by the shell's own check, so
+        // only look for red/blue crossings in the overlap of the two shells
+        float left = std::max(shellA.left, shellB->left);
+        float right = std::min(shellA.right, shellB->right);
+        float bottom = std::max(shellA.bottom, shellB->bottom);
+        float top = std::min(shellA.top, shellB->top);
+        b.addSegments(shellA.begin, shellA.end, BentleyOttmann::RED, left, bottom, right, top);
+        b.addSegments(shellB->begin, shellB->end, BentleyOttmann::BLUE, left, bottom, right, top);
+    }
     b.check(result);
-    pushToLineVector(result);
 }
 
-void FindUvOverlaps::pushToLineVector(std::vector<LineSegment>& v)
+bool FindUvOverlaps::isResolved(const UVCheck& check) const
 {
-    try {
-        locker.lock();
-        finalResult.push_back(v);
-        locker.unlock();
-    } catch (std::exception& e) {
-        std::cerr << e.what() << std::endl;
+    // A check can only tell something new about meshes not known to overlap
+    if (!meshOverlaps[segments.meshId[check.shellA->begin]]) {
+        return false;
     }
+    return check.shellB == nullptr || meshOverlaps[segments.meshId[check.shellB->begin]];
 }
 
-void FindUvOverlaps::pushToShellVector(UVShell& shell)
+void FindUvOverlaps::setMeshOverlaps(const std::vector<unsigned int>& result, size_t begin)
 {
-    try {
-        locker.lock();
+    for (size_t i = begin; i < result.size(); i++) {
+        meshOverlaps[segments.meshId[result[i]]] = true;
+    }
+}
+
+void FindUvOverlaps::gatherShells(const MeshShells& meshShells)
+{
+    size_t offset = segments.size();
+    segments.append(meshShells.segments);
+    size_t triangleOffset = triangles.size();
+    triangles.insert(triangles.end(), meshShells.triangles.begin(), meshShells.triangles.end());
+    for (auto shell : meshShells.shells) {
+        shell.begin += offset;
+        shell.end += offset;
+        shell.triangleBegin += triangleOffset;
+        shell.triangleEnd += triangleOffset;
         shellVector.push_back(shell);
-        locker.unlock();
-    } catch (std::exception& e) {
-        std::cerr << e.what() << std::endl;
     }
 }
 
@@ -125,121 +383,895 @@ MStatus FindUvOverlaps::doIt(const MArgList& args)
     else
         uvSet = "None";
 
+    if (argData.isFlagSet("-bruteForceThreshold"))
+        argData.getFlagArgument("-bruteForceThreshold", 0, bruteForceThreshold);
+    else
+        bruteForceThreshold = static_cast<unsigned int>(bruteForce::getDefaultThreshold());
+
+    if (argData.isFlagSet("-threads"))
+        argData.getFlagArgument("-threads", 0, numThreads);
+    else
+        numThreads = std::thread::hardware_concurrency();
+    numThreads = std::max(numThreads, 1U);
+
+    if (argData.isFlagSet("-anyOverlap"))
+        argData.getFlagArgument("-anyOverlap", 0, anyMode);
+    else
+        anyMode = false;
+
+    if (argData.isFlagSet("-udimTiles"))
+        argData.getFlagArgument("-udimTiles", 0, udimMode);
+    else
+        udimMode = false;
+
+    if (argData.isFlagSet("-byShadingGroup"))
+        argData.getFlagArgument("-byShadingGroup", 0, shadingGroupMode);
+    else
+        shadingGroupMode = false;
+
+    if (argData.isFlagSet("-engine"))
+        argData.getFlagArgument("-engine", 0, engine);
+    else
+        engine = "sweep";
+
+    if (argData.isFlagSet("-cache"))
+        argData.getFlagArgument("-cache", 0, cacheMode);
+    else
+        cacheMode = false;
+    if (argData.isFlagSet("-overlapArea"))
+        argData.getFlagArgument("-overlapArea", 0, areaMode);
+    else
+        areaMode = false;
+    areaMode = areaMode && !anyMode;
+
+    // Cached results are uvs, without the edges the area mode needs
+    cacheMode = cacheMode && !anyMode && !areaMode && engine == "sweep";
+
     MGlobal::getActiveSelectionList(mSel);
 
+    unsigned int numSelected = mSel.length();
+    meshPaths.resize(numSelected);
+    std::vector<std::atomic<bool> >(numSelected).swap(meshOverlaps);
+    for (auto& meshOverlap : meshOverlaps) {
+        meshOverlap = false;
+    }
+
+    // Maya calls stay on the main thread, which copies everything the checks
+    // need from each mesh. Edges and shells are then built from the copies
+    // in parallel, without any lock or Maya call
     timer.beginTimer();
-    // Multithrad obj initialization
-    // std::thread* threadArray = new std::thread[mSel.length()];
-    // for (size_t i = 0; i < mSel.length(); i++) {
-    //     threadArray[i] = std::thread(&FindUvOverlaps::init, this, i);
-    // }
-    // for (size_t i = 0; i < mSel.length(); i++) {
-    //     threadArray[i].join();
-    // }
-    // delete[] threadArray;
-
-    int numSelected = static_cast<int>(mSel.length());
-#pragma omp parallel for
-    for (int i = 0; i < numSelected; i++) {
-        init(i);
+    std::vector<MeshSnapshot> snapshots(numSelected);
+    for (unsigned int i = 0; i < numSelected; i++) {
+        snapshotMesh(i, snapshots[i]);
     }
+    timer.endTimer();
+    elapsedTime = timer.elapsedTime();
+    if (verbose)
+        timeIt("Extraction time : ", elapsedTime);
+    timer.clear();
 
+    timer.beginTimer();
+    std::vector<MeshShells> meshShells(numSelected);
+    auto numMeshes = static_cast<int>(numSelected);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numMeshes; i++) {
+        auto meshId = static_cast<unsigned int>(i);
+        buildShells(meshId, snapshots[meshId], meshShells[meshId]);
+        snapshots[meshId] = MeshSnapshot();
+    }
+    // Gathered in selection order, so results don't depend on scheduling
+    for (auto& mesh : meshShells) {
+        gatherShells(mesh);
+        mesh = MeshShells();
+    }
     timer.endTimer();
     elapsedTime = timer.elapsedTime();
     if (verbose)
-        timeIt("Init time : ", elapsedTime);
+        timeIt("Build time : ", elapsedTime);
     timer.clear();
 
-    size_t numAllShells = shellVector.size();
+    // Broad phase, pairs of shells whose bounding boxes overlap. The sweep
+    // checks their edges, and both engines look for shells inside others
+    timer.beginTimer();
+    for (auto& shell : shellVector) {
+        shell.initAABB(segments);
+    }
+    shellPairs.clear();
+    size_t numSkippedPairs = findShellPairs(shellPairs);
+    timer.endTimer();
+    elapsedTime = timer.elapsedTime();
+    if (verbose) {
+        timeIt("Broad phase time : ", elapsedTime);
+        MString numShellPairsStr;
+        numShellPairsStr.set(static_cast<int>(shellPairs.size()));
+        MGlobal::displayInfo("Number of shell pairs : " + numShellPairsStr);
+        if (shadingGroupMode) {
+            MString numSkippedPairsStr, numShadingGroupsStr;
+            numSkippedPairsStr.set(static_cast<int>(numSkippedPairs));
+            numShadingGroupsStr.set(static_cast<int>(shadingGroupIds.size()));
+            MGlobal::displayInfo("Shell pairs without a common shading group : " + numSkippedPairsStr
+                + " (" + numShadingGroupsStr + " shading groups)");
+        }
+        if (udimMode) {
+            std::unordered_set<int64_t> tiles;
+            for (const auto& shell : shellVector) {
+                tiles.insert(getTileKey(shell.tileU, shell.tileV));
+            }
+            MString numTilesStr;
+            numTilesStr.set(static_cast<int>(tiles.size()));
+            MGlobal::displayInfo("Number of UDIM tiles : " + numTilesStr);
+        }
+    }
+    timer.clear();
 
-    for (size_t i = 0; i < numAllShells; i++) {
-        UVShell& s = shellVector[i];
-        s.initAABB();
+    if (engine == "grid") {
+        checkGrid();
+    } else if (engine == "sweep") {
+        checkShells();
+    } else {
+        MGlobal::displayError("Unknown engine : " + engine + ". Use sweep or grid.");
+        return MS::kFailure;
     }
 
-    std::vector<UVShell> shells; // temp countainer to store both original and combined shells
+    checkContainment();
+    if (cacheMode) {
+        updateCache();
+    }
 
-    for (size_t i = 0; i < numAllShells; i++) {
-        UVShell& shellA = shellVector[i];
-        shells.push_back(shellA);
+    if (anyMode) {
+        // One flag per selected object, in selection order
+        MIntArray overlapArray;
+        for (const auto& meshOverlap : meshOverlaps) {
+            overlapArray.append(meshOverlap ? 1 : 0);
+        }
+        setResult(overlapArray);
+        return MS::kSuccess;
+    }
+
+    if (areaMode) {
+        setResult(getOverlapAreas());
+        return MS::kSuccess;
+    }
+
+    timer.beginTimer();
+    // Results as (mesh id, uv index) keys, formatted only once duplicates
+    // are gone. Tile mode keeps one list of keys per tile, in UDIM order
+    std::vector<std::pair<int, int> > tiles(1, std::make_pair(0, 0));
+    if (udimMode) {
+        tiles.clear();
+        for (const auto& shell : shellVector) {
+            tiles.emplace_back(shell.tileV, shell.tileU);
+        }
+        std::sort(tiles.begin(), tiles.end());
+        tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+    }
+    auto getTileSlot = [&tiles](int u, int v) {
+        return static_cast<size_t>(std::lower_bound(tiles.begin(), tiles.end(), std::make_pair(v, u)) - tiles.begin());
+    };
+    auto getKey = [this](size_t line, int uv) {
+        return (static_cast<uint64_t>(segments.meshId[line]) << 32) | static_cast<uint32_t>(uv);
+    };
+
+    std::vector<std::vector<uint64_t> > tileKeys(tiles.size());
+    size_t tileSlot = 0;
+    for (auto&& lines : finalResult) {
+        for (size_t i = 0; i + 1 < lines.size(); i += 2) {
+            if (udimMode) {
+                // Pieces of different tiles can only meet on a tile border
+                int uA, vA, uB, vB;
+                getSegmentTile(segments, lines[i], uA, vA);
+                getSegmentTile(segments, lines[i + 1], uB, vB);
+                if (uA != uB || vA != vB) {
+                    continue;
+                }
+                tileSlot = getTileSlot(uA, vA);
+            }
+            std::vector<uint64_t>& keys = tileKeys[tileSlot];
+            keys.push_back(getKey(lines[i], segments.uvA[lines[i]]));
+            keys.push_back(getKey(lines[i], segments.uvB[lines[i]]));
+            keys.push_back(getKey(lines[i + 1], segments.uvA[lines[i + 1]]));
+            keys.push_back(getKey(lines[i + 1], segments.uvB[lines[i + 1]]));
+        }
+    }
+    // A shell inside another one overlaps as a whole
+    for (const UVShell* shell : containedShells) {
+        if (udimMode) {
+            tileSlot = getTileSlot(shell->tileU, shell->tileV);
+        }
+        std::vector<uint64_t>& keys = tileKeys[tileSlot];
+        for (size_t line = shell->begin; line < shell->end; line++) {
+            keys.push_back(getKey(line, segments.uvA[line]));
+            keys.push_back(getKey(line, segments.uvB[line]));
+        }
+    }
+    // Cached uvs are within the mesh of their shell
+    for (const auto& cachedResult : cachedResults) {
+        const UVShell* shell = cachedResult.first;
+        if (udimMode) {
+            tileSlot = getTileSlot(shell->tileU, shell->tileV);
+        }
+        std::vector<uint64_t>& keys = tileKeys[tileSlot];
+        for (uint32_t uv : *cachedResult.second) {
+            keys.push_back(getKey(shell->begin, static_cast<int>(uv)));
+        }
+    }
+    for (auto& keys : tileKeys) {
+        sortUnique(keys, numThreads);
+    }
 
-        for (size_t j = i + 1; j < numAllShells; j++) {
-            UVShell& shellB = shellVector[j];
+    timer.endTimer();
+    elapsedTime = timer.elapsedTime();
+    if (verbose)
+        timeIt("Removed duplicates : ", elapsedTime);
+    timer.clear();
 
-            if (shellA * shellB) {
-                UVShell intersectedShell = shellA && shellB;
-                shells.push_back(intersectedShell);
+    // Sorted by tile, mesh in selection order and uv index. In tile mode
+    // each result is prefixed with its tile, eg. "1001 |pSphere1|pSphereShape1.map[12]"
+    MStringArray resultStringArray;
+    std::string path;
+    for (size_t tile = 0; tile < tiles.size(); tile++) {
+        std::string tileName;
+        if (udimMode) {
+            tileName = getTileName(tiles[tile].second, tiles[tile].first) + " ";
+        }
+        const std::vector<uint64_t>& keys = tileKeys[tile];
+        size_t prefixSize = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto meshId = static_cast<unsigned int>(keys[i] >> 32);
+            if (i == 0 || meshId != static_cast<unsigned int>(keys[i - 1] >> 32)) {
+                path = tileName + meshPaths[meshId].asChar() + ".map[";
+                prefixSize = path.size();
             }
+            path.resize(prefixSize);
+            path += std::to_string(static_cast<uint32_t>(keys[i]));
+            path += ']';
+            resultStringArray.append(MString(path.c_str()));
+        }
+    }
+
+    setResult(resultStringArray);
+
+    if (cacheMode) {
+        OverlapCache& cache = OverlapCache::get();
+        if (verbose) {
+            MString numShellsStr, numPairsStr;
+            numShellsStr.set(static_cast<int>(cache.getNumShells()));
+            numPairsStr.set(static_cast<int>(cache.getNumPairs()));
+            MGlobal::displayInfo("Cache size : " + numShellsStr + " shells, " + numPairsStr + " shell pairs");
         }
+        cache.endRun();
     }
 
+    return MS::kSuccess;
+}
+
+
+size_t FindUvOverlaps::findShellPairs(std::vector<UVShellPair>& pairs) const
+{
+    // Register every shell in each UDIM tile its bounding box touches. Pairs
+    // overlapping across several tiles are reported by the tile holding the
+    // lower left corner of their overlap, which both shells are registered in
+    struct TileEntry {
+        int64_t tile;
+        size_t shell;
+    };
+    std::vector<TileEntry> entries;
+    size_t numShells = shellVector.size();
+    entries.reserve(numShells);
+    bool isTiled = true;
+    for (size_t i = 0; i < numShells; i++) {
+        const UVShell& shell = shellVector[i];
+        int beginU = getTileIndex(shell.left);
+        int endU = getTileIndex(shell.right);
+        int beginV = getTileIndex(shell.bottom);
+        int endV = getTileIndex(shell.top);
+
+        // Shells spread over many tiles make tiling pointless, so check
+        // everything as a single tile instead
+        int64_t numShellTiles = (static_cast<int64_t>(endU) - beginU + 1) * (static_cast<int64_t>(endV) - beginV + 1);
+        if (static_cast<int64_t>(entries.size()) + numShellTiles > static_cast<int64_t>(numShells * 4 + 64)) {
+            isTiled = false;
+            break;
+        }
+        for (int u = beginU; u <= endU; u++) {
+            for (int v = beginV; v <= endV; v++) {
+                entries.push_back({ getTileKey(u, v), i });
+            }
+        }
+    }
+    if (!isTiled) {
+        entries.clear();
+        for (size_t i = 0; i < numShells; i++) {
+            entries.push_back({ 0, i });
+        }
+    }
+
+    // Sort each tile's shells by their left side, then sweep and prune
+    std::sort(entries.begin(), entries.end(), [this](const TileEntry& a, const TileEntry& b) {
+        if (a.tile != b.tile) {
+            return a.tile < b.tile;
+        }
+        float leftA = shellVector[a.shell].left;
+        float leftB = shellVector[b.shell].left;
+        if (leftA != leftB) {
+            return leftA < leftB;
+        }
+        return a.shell < b.shell;
+    });
+
+    std::vector<size_t> tileOffsets;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i == 0 || entries[i].tile != entries[i - 1].tile) {
+            tileOffsets.push_back(i);
+        }
+    }
+    tileOffsets.push_back(entries.size());
+
+    auto numTiles = static_cast<int>(tileOffsets.size() - 1);
+    std::vector<std::vector<UVShellPair> > tilePairs(tileOffsets.size() - 1);
+    std::vector<size_t> tileSkippedPairs(tileOffsets.size() - 1, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int tile = 0; tile < numTiles; tile++) {
+        auto tileIndex = static_cast<size_t>(tile);
+        size_t tileBegin = tileOffsets[tileIndex];
+        size_t tileEnd = tileOffsets[tileIndex + 1];
+        int64_t tileKey = entries[tileBegin].tile;
+        std::vector<UVShellPair>& result = tilePairs[tileIndex];
+
+        for (size_t i = tileBegin; i < tileEnd; i++) {
+            const UVShell& shellA = shellVector[entries[i].shell];
+            for (size_t j = i + 1; j < tileEnd; j++) {
+                const UVShell& shellB = shellVector[entries[j].shell];
+                if (shellB.left > shellA.right) {
+                    break;
+                }
+                if (shellA.top < shellB.bottom || shellA.bottom > shellB.top) {
+                    continue;
+                }
+                // Shells of neighbouring tiles meet at the tile border
+                if (udimMode && (shellA.tileU != shellB.tileU || shellA.tileV != shellB.tileV)) {
+                    continue;
+                }
+                if (isTiled) {
+                    int u = getTileIndex(std::max(shellA.left, shellB.left));
+                    int v = getTileIndex(std::max(shellA.bottom, shellB.bottom));
+                    if (getTileKey(u, v) != tileKey) {
+                        continue;
+                    }
+                }
+                if (shadingGroupMode && !shareShadingGroup(shellA, shellB)) {
+                    tileSkippedPairs[tileIndex]++;
+                    continue;
+                }
+                if (entries[i].shell < entries[j].shell) {
+                    result.emplace_back(&shellA, &shellB);
+                } else {
+                    result.emplace_back(&shellB, &shellA);
+                }
+            }
+        }
+    }
+
+    size_t numSkippedPairs = 0;
+    for (size_t tile = 0; tile < tilePairs.size(); tile++) {
+        pairs.insert(pairs.end(), tilePairs[tile].begin(), tilePairs[tile].end());
+        numSkippedPairs += tileSkippedPairs[tile];
+    }
+    return numSkippedPairs;
+}
+
+void FindUvOverlaps::checkShells()
+{
+    MTimer timer;
+    double elapsedTime;
+
+    size_t numAllShells = shellVector.size();
+
+    timer.beginTimer();
+
+    // Shells to check, either a single shell or a pair of shells whose
+    // bounding boxes overlap. Both refer to the segment store directly
+    const float infinity = std::numeric_limits<float>::infinity();
+    size_t numShellPairs = shellPairs.size();
+
+    // Shells and pairs found in the cache don't need any check
+    std::vector<unsigned char> isShellCached(numAllShells, 0);
+    isPairCached.assign(numShellPairs, 0);
+    if (cacheMode) {
+        auto numShells = static_cast<int>(numAllShells);
+        shellHashes.resize(numAllShells);
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < numShells; i++) {
+            const UVShell& shell = shellVector[static_cast<size_t>(i)];
+            shellHashes[static_cast<size_t>(i)] = OverlapCache::hashShell(segments, shell.begin, shell.end,
+                triangles, shell.triangleBegin, shell.triangleEnd);
+        }
+
+        OverlapCache& cache = OverlapCache::get();
+        for (size_t i = 0; i < numAllShells; i++) {
+            const std::vector<uint32_t>* uvs = cache.findShell(shellHashes[i]);
+            if (uvs != nullptr) {
+                isShellCached[i] = 1;
+                cachedResults.emplace_back(&shellVector[i], uvs);
+            }
+        }
+        for (size_t i = 0; i < numShellPairs; i++) {
+            const UVShellPair& shellPair = shellPairs[i];
+            const std::vector<uint32_t>* uvsA;
+            const std::vector<uint32_t>* uvsB;
+            if (cache.findPair(shellHashes[getShellIndex(shellPair.first->begin)], shellHashes[getShellIndex(shellPair.second->begin)], uvsA, uvsB)) {
+                isPairCached[i] = 1;
+                cachedResults.emplace_back(shellPair.first, uvsA);
+                cachedResults.emplace_back(shellPair.second, uvsB);
+            }
+        }
+        pairUvs.assign(2 * numShellPairs, std::vector<uint32_t>());
+
+        if (verbose) {
+            MString numShellsStr, numPairsStr;
+            numShellsStr.set(static_cast<int>(std::count(isShellCached.begin(), isShellCached.end(), 1)));
+            numPairsStr.set(static_cast<int>(std::count(isPairCached.begin(), isPairCached.end(), 1)));
+            MGlobal::displayInfo("Cached shells : " + numShellsStr + ", cached shell pairs : " + numPairsStr);
+        }
+    }
+
+    std::vector<UVCheck> checks;
+    checks.reserve(numShellPairs + numAllShells);
+    for (size_t i = 0; i < numShellPairs; i++) {
+        if (isPairCached[i] != 0) {
+            continue;
+        }
+        const UVShellPair& shellPair = shellPairs[i];
+        size_t numEdges = (shellPair.first->end - shellPair.first->begin) + (shellPair.second->end - shellPair.second->begin);
+        checks.push_back({ shellPair.first, shellPair.second, -infinity, infinity, numEdges, i });
+    }
+
+    // A single sweep over a huge shell would keep one thread busy long after
+    // the others are done, so cut such shells into slabs checked in parallel
+    const size_t minSlabEdges = 32768;
+    size_t numSlabShells = 0;
+    std::vector<float> slabBorders;
+    for (size_t i = 0; i < numAllShells; i++) {
+        if (isShellCached[i] != 0) {
+            continue;
+        }
+        const UVShell& shell = shellVector[i];
+        size_t numEdges = shell.end - shell.begin;
+        size_t numSlabs = std::min(static_cast<size_t>(numThreads), numEdges / minSlabEdges);
+        if (numSlabs < 2 || numEdges < bruteForceThreshold) {
+            checks.push_back({ &shell, nullptr, -infinity, infinity, numEdges, i });
+            continue;
+        }
+
+        BentleyOttmann::getSlabBorders(segments, shell.begin, shell.end, numSlabs, slabBorders);
+        for (size_t slab = 0; slab + 1 < slabBorders.size(); slab++) {
+            checks.push_back({ &shell, nullptr, slabBorders[slab], slabBorders[slab + 1], numEdges / numSlabs, i });
+        }
+        numSlabShells++;
+    }
+
+    timer.endTimer();
+    elapsedTime = timer.elapsedTime();
+    if (verbose)
+        timeIt("Check setup time : ", elapsedTime);
+    timer.clear();
+
     timer.beginTimer();
 
     if (verbose) {
         MString numShellsStr;
-        numShellsStr.set(static_cast<int>(shells.size()));
+        numShellsStr.set(static_cast<int>(checks.size()));
         MGlobal::displayInfo("Number of UvShells : " + numShellsStr);
+
+        auto numBruteForce = std::count_if(checks.begin(), checks.end(),
+            [this](const UVCheck& check) {
+                return check.numEdges < bruteForceThreshold;
+            });
+        MString numBruteForceStr;
+        numBruteForceStr.set(static_cast<int>(numBruteForce));
+        MGlobal::displayInfo("Brute force checks : " + numBruteForceStr);
+
+        MString numSlabShellsStr;
+        numSlabShellsStr.set(static_cast<int>(numSlabShells));
+        MGlobal::displayInfo("Shells split into slabs : " + numSlabShellsStr);
     }
 
-    // Multithread bentleyOttman check
-    size_t numAllShells2 = shells.size();
-    auto* btoThreadArray = new std::thread[numAllShells2];
-    for (size_t i = 0; i < numAllShells2; i++) {
-        UVShell& s = shells[i];
-        btoThreadArray[i] = std::thread(&FindUvOverlaps::btoCheck, this, std::ref(s));
+    // Biggest checks first, so that the long ones don't end up last and
+    // leave the other threads idle
+    std::stable_sort(checks.begin(), checks.end(), [](const UVCheck& a, const UVCheck& b) {
+        return a.numEdges > b.numEdges;
+    });
+
+    // Multithread bentleyOttman check. Each worker takes the next check from
+    // the list until none is left, and keeps its own result. In cache mode
+    // every check keeps its own result instead, to be cached afterwards
+    std::atomic<size_t> nextCheck(0);
+    std::vector<std::future<std::vector<unsigned int> > > workerResults;
+    std::vector<std::vector<unsigned int> > checkResults(cacheMode ? checks.size() : 0);
+    {
+        ThreadPool pool(numThreads);
+        for (unsigned int i = 0; i < numThreads; i++) {
+            workerResults.push_back(pool.enqueue([this, &checks, &nextCheck, &checkResults]() {
+                std::vector<unsigned int> result;
+                for (size_t check = nextCheck++; check < checks.size(); check = nextCheck++) {
+                    if (anyMode) {
+                        if (!isResolved(checks[check])) {
+                            btoCheck(checks[check], result);
+                            setMeshOverlaps(result, 0);
+                            result.clear();
+                        }
+                        continue;
+                    }
+                    btoCheck(checks[check], cacheMode ? checkResults[check] : result);
+                }
+                return result;
+            }));
+        }
+        for (auto& workerResult : workerResults) {
+            finalResult.push_back(workerResult.get());
+        }
     }
-    for (size_t i = 0; i < numAllShells2; i++) {
-        btoThreadArray[i].join();
+
+    if (cacheMode) {
+        // Shell results are complete, pair results still miss contained
+        // shells and are cached by updateCache
+        std::vector<std::vector<uint32_t> > shellUvs(numAllShells);
+        std::vector<unsigned char> isShellChecked(numAllShells, 0);
+        for (size_t i = 0; i < checks.size(); i++) {
+            const UVCheck& check = checks[i];
+            for (unsigned int line : checkResults[i]) {
+                std::vector<uint32_t>* uvs;
+                if (check.shellB == nullptr) {
+                    uvs = &shellUvs[check.source];
+                } else {
+                    bool isFirst = line >= check.shellA->begin && line < check.shellA->end;
+                    uvs = &pairUvs[2 * check.source + (isFirst ? 0 : 1)];
+                }
+                uvs->push_back(static_cast<uint32_t>(segments.uvA[line]));
+                uvs->push_back(static_cast<uint32_t>(segments.uvB[line]));
+            }
+            if (check.shellB == nullptr) {
+                isShellChecked[check.source] = 1;
+            }
+            finalResult.push_back(std::move(checkResults[i]));
+        }
+        OverlapCache& cache = OverlapCache::get();
+        for (size_t i = 0; i < numAllShells; i++) {
+            if (isShellChecked[i] != 0) {
+                cache.addShell(shellHashes[i], std::move(shellUvs[i]));
+            }
+        }
     }
-    delete[] btoThreadArray;
 
     timer.endTimer();
     elapsedTime = timer.elapsedTime();
     if (verbose)
         timeIt("Check time : ", elapsedTime);
     timer.clear();
+}
 
+void FindUvOverlaps::checkGrid()
+{
+    MTimer timer;
     timer.beginTimer();
-    // Re-insert to set to remove duplicates
-    std::string temp_path;
-    std::unordered_set<std::string> temp;
-    for (auto&& lines : finalResult) {
-        for (auto&& line : lines) {
-            std::string groupName(line.groupId);
-            temp_path = groupName + ".map[" + std::to_string(line.index.first) + "]";
-            temp.insert(temp_path);
-            temp_path = groupName + ".map[" + std::to_string(line.index.second) + "]";
-            temp.insert(temp_path);
+
+    // All edges of all meshes go into a single grid, shells don't matter here
+    UniformGrid grid(segments);
+    grid.addSegments(0, segments.size());
+    std::vector<unsigned int> result;
+    grid.check(result, numThreads);
+    if (shadingGroupMode) {
+        // The grid doesn't know about shells, so drop crossings of shells
+        // without a common shading group afterwards
+        size_t numKept = 0;
+        for (size_t i = 0; i + 1 < result.size(); i += 2) {
+            const UVShell& shellA = shellVector[getShellIndex(result[i])];
+            const UVShell& shellB = shellVector[getShellIndex(result[i + 1])];
+            if (&shellA == &shellB || shareShadingGroup(shellA, shellB)) {
+                result[numKept++] = result[i];
+                result[numKept++] = result[i + 1];
+            }
         }
+        result.resize(numKept);
+    }
+    if (anyMode) {
+        setMeshOverlaps(result, 0);
+    } else {
+        finalResult.push_back(result);
     }
 
-    // Remove duplicates
     timer.endTimer();
-    elapsedTime = timer.elapsedTime();
-    if (verbose)
-        timeIt("Removed duplicates : ", elapsedTime);
-    timer.clear();
+    if (verbose) {
+        MString numCellsStr, cellSizeStr;
+        numCellsStr.set(static_cast<int>(grid.getNumCells()));
+        cellSizeStr.set(grid.getCellSize());
+        MGlobal::displayInfo("Grid cells : " + numCellsStr + ", cell size : " + cellSizeStr);
+        timeIt("Check time : ", timer.elapsedTime());
+    }
+}
 
-    // Insert all results to MStringArray for return
-    MString s;
-    MStringArray resultStringArray;
+void FindUvOverlaps::updateCache()
+{
+    // Checked pairs are complete once containment is known
+    OverlapCache& cache = OverlapCache::get();
+    for (size_t pair = 0; pair < shellPairs.size(); pair++) {
+        if (isPairCached[pair] != 0) {
+            continue;
+        }
+        cache.addPair(shellHashes[getShellIndex(shellPairs[pair].first->begin)],
+            shellHashes[getShellIndex(shellPairs[pair].second->begin)],
+            std::move(pairUvs[2 * pair]), std::move(pairUvs[2 * pair + 1]));
+    }
+}
 
-    for (const auto& fullpath : temp) {
-        s.set(fullpath.c_str());
-        resultStringArray.append(s);
+size_t FindUvOverlaps::getShellIndex(size_t edge) const
+{
+    // Shells hold consecutive ranges of the store, in order
+    auto it = std::upper_bound(shellVector.begin(), shellVector.end(), edge,
+        [](size_t index, const UVShell& shell) { return index < shell.begin; });
+    return static_cast<size_t>(it - shellVector.begin()) - 1;
+}
+
+unsigned int FindUvOverlaps::getShadingGroupId(const std::string& name)
+{
+    auto it = shadingGroupIds.find(name);
+    if (it == shadingGroupIds.end()) {
+        auto id = static_cast<unsigned int>(shadingGroupIds.size());
+        it = shadingGroupIds.insert(std::make_pair(name, id)).first;
     }
+    return it->second;
+}
 
-    setResult(resultStringArray);
+void FindUvOverlaps::checkContainment()
+{
+    MTimer timer;
+    timer.beginTimer();
 
-    return MS::kSuccess;
+    // Shell pairs with crossing edges already overlap. In any mode results
+    // are gone, but then pairs of meshes known to overlap can be skipped
+    PairSet crossedShells;
+    if (!anyMode) {
+        for (const auto& result : finalResult) {
+            for (size_t i = 0; i + 1 < result.size(); i += 2) {
+                size_t shellA = getShellIndex(result[i]);
+                size_t shellB = getShellIndex(result[i + 1]);
+                if (shellA != shellB) {
+                    crossedShells.insert(shellA, shellB);
+                }
+            }
+        }
+    }
+
+    // A shell can only be inside another one if its bounding box is, and
+    // without crossings a single point of it tells whether it is
+    // In tile mode the point of the inner shell has to be in the tile too
+    auto isBoxInside = [this](const UVShell& inner, const UVShell& outer) {
+        if (udimMode && (getTileIndex(inner.insideU) != inner.tileU || getTileIndex(inner.insideV) != inner.tileV)) {
+            return false;
+        }
+        return inner.triangleBegin != inner.triangleEnd && outer.triangleBegin != outer.triangleEnd
+            && inner.left >= outer.left && inner.right <= outer.right
+            && inner.bottom >= outer.bottom && inner.top <= outer.top;
+    };
+    // Inner and outer shell, and the index of their pair
+    struct Candidate {
+        const UVShell* inner;
+        const UVShell* outer;
+        size_t pair;
+    };
+    std::vector<Candidate> candidates;
+    std::vector<const UVShell*> outerShells;
+    for (size_t pair = 0; pair < shellPairs.size(); pair++) {
+        const UVShell& shellA = *shellPairs[pair].first;
+        const UVShell& shellB = *shellPairs[pair].second;
+        if (cacheMode && isPairCached[pair] != 0) {
+            continue;
+        }
+        if (anyMode) {
+            if (meshOverlaps[segments.meshId[shellA.begin]] && meshOverlaps[segments.meshId[shellB.begin]]) {
+                continue;
+            }
+        } else if (crossedShells.contains(getShellIndex(shellA.begin), getShellIndex(shellB.begin))) {
+            continue;
+        }
+        if (isBoxInside(shellA, shellB)) {
+            candidates.push_back({ &shellA, &shellB, pair });
+            outerShells.push_back(&shellB);
+        }
+        if (isBoxInside(shellB, shellA)) {
+            candidates.push_back({ &shellB, &shellA, pair });
+            outerShells.push_back(&shellA);
+        }
+    }
+    std::sort(outerShells.begin(), outerShells.end());
+    outerShells.erase(std::unique(outerShells.begin(), outerShells.end()), outerShells.end());
+
+    // Only shells which may hold another one need a tree
+    auto numOuterShells = static_cast<int>(outerShells.size());
+    std::vector<TriangleBVH> trees(outerShells.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numOuterShells; i++) {
+        const UVShell& shell = *outerShells[static_cast<size_t>(i)];
+        trees[static_cast<size_t>(i)].build(triangles.data() + shell.triangleBegin, triangles.data() + shell.triangleEnd);
+    }
+
+    auto numCandidates = static_cast<int>(candidates.size());
+    std::vector<unsigned char> isContained(candidates.size(), 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numCandidates; i++) {
+        const Candidate& candidate = candidates[static_cast<size_t>(i)];
+        auto tree = std::lower_bound(outerShells.begin(), outerShells.end(), candidate.outer) - outerShells.begin();
+        isContained[static_cast<size_t>(i)] = trees[static_cast<size_t>(tree)].contains(candidate.inner->insideU, candidate.inner->insideV) ? 1 : 0;
+    }
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (isContained[i] == 0) {
+            continue;
+        }
+        const Candidate& candidate = candidates[i];
+        if (anyMode) {
+            meshOverlaps[segments.meshId[candidate.inner->begin]] = true;
+            meshOverlaps[segments.meshId[candidate.outer->begin]] = true;
+            continue;
+        }
+        containedShells.push_back(candidate.inner);
+        if (areaMode) {
+            containedPairs.emplace_back(candidate.inner, candidate.outer);
+        }
+        if (cacheMode) {
+            bool isFirst = shellPairs[candidate.pair].first == candidate.inner;
+            std::vector<uint32_t>& uvs = pairUvs[2 * candidate.pair + (isFirst ? 0 : 1)];
+            for (size_t line = candidate.inner->begin; line < candidate.inner->end; line++) {
+                uvs.push_back(static_cast<uint32_t>(segments.uvA[line]));
+                uvs.push_back(static_cast<uint32_t>(segments.uvB[line]));
+            }
+        }
+    }
+    std::sort(containedShells.begin(), containedShells.end());
+    containedShells.erase(std::unique(containedShells.begin(), containedShells.end()), containedShells.end());
+
+    timer.endTimer();
+    if (verbose) {
+        MString numCandidatesStr, numContainedStr;
+        numCandidatesStr.set(numCandidates);
+        numContainedStr.set(static_cast<int>(containedShells.size()));
+        MGlobal::displayInfo("Containment candidates : " + numCandidatesStr + ", contained shells : " + numContainedStr);
+        timeIt("Containment time : ", timer.elapsedTime());
+    }
 }
 
-MStatus FindUvOverlaps::init(int i)
+MStringArray FindUvOverlaps::getOverlapAreas() const
+{
+    MTimer timer;
+    timer.beginTimer();
+
+    // Crossing edges of each pair of different shells, as (shell A, shell B,
+    // edge of A, edge of B) with shell A first. Pieces of different tiles
+    // only meet on a tile border
+    struct Crossing {
+        size_t shellA, shellB;
+        unsigned int lineA, lineB;
+        bool operator<(const Crossing& other) const
+        {
+            if (shellA != other.shellA)
+                return shellA < other.shellA;
+            if (shellB != other.shellB)
+                return shellB < other.shellB;
+            if (lineA != other.lineA)
+                return lineA < other.lineA;
+            return lineB < other.lineB;
+        }
+        bool operator==(const Crossing& other) const
+        {
+            return shellA == other.shellA && shellB == other.shellB && lineA == other.lineA && lineB == other.lineB;
+        }
+    };
+    std::vector<Crossing> crossings;
+    for (const auto& result : finalResult) {
+        for (size_t i = 0; i + 1 < result.size(); i += 2) {
+            Crossing crossing = { getShellIndex(result[i]), getShellIndex(result[i + 1]), result[i], result[i + 1] };
+            if (crossing.shellA == crossing.shellB) {
+                continue;
+            }
+            if (udimMode) {
+                const UVShell& shellA = shellVector[crossing.shellA];
+                const UVShell& shellB = shellVector[crossing.shellB];
+                if (shellA.tileU != shellB.tileU || shellA.tileV != shellB.tileV) {
+                    continue;
+                }
+            }
+            if (crossing.shellA > crossing.shellB) {
+                std::swap(crossing.shellA, crossing.shellB);
+                std::swap(crossing.lineA, crossing.lineB);
+            }
+            crossings.push_back(crossing);
+        }
+    }
+    std::sort(crossings.begin(), crossings.end());
+    crossings.erase(std::unique(crossings.begin(), crossings.end()), crossings.end());
+
+    // One record per pair of overlapping shells, with the crossing points
+    // of their edges. Contained shells have no crossing
+    struct Overlap {
+        const UVShell* shellA;
+        const UVShell* shellB;
+        std::vector<float> points;
+        double area;
+    };
+    std::vector<Overlap> overlaps;
+    for (size_t i = 0; i < crossings.size(); i++) {
+        const Crossing& crossing = crossings[i];
+        if (i == 0 || crossing.shellA != crossings[i - 1].shellA || crossing.shellB != crossings[i - 1].shellB) {
+            overlaps.push_back({ &shellVector[crossing.shellA], &shellVector[crossing.shellB], std::vector<float>(), 0.0 });
+        }
+        float x, y;
+        if (segments.getIntersectionPoint(crossing.lineA, crossing.lineB, x, y)) {
+            overlaps.back().points.push_back(x);
+            overlaps.back().points.push_back(y);
+        }
+    }
+    for (const auto& pair : containedPairs) {
+        overlaps.push_back({ pair.first, pair.second, std::vector<float>(), 0.0 });
+    }
+
+    // Triangles of both shells clipped by each other, within the overlap of
+    // their bounding boxes. Tile shells keep the triangles of the whole
+    // shell, but their boxes don't leave the tile
+    auto numOverlaps = static_cast<int>(overlaps.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numOverlaps; i++) {
+        Overlap& overlap = overlaps[static_cast<size_t>(i)];
+        const UVShell& shellA = *overlap.shellA;
+        const UVShell& shellB = *overlap.shellB;
+        overlap.area = overlapArea::getOverlap(triangles,
+            shellA.triangleBegin, shellA.triangleEnd, shellB.triangleBegin, shellB.triangleEnd,
+            std::max(shellA.left, shellB.left), std::max(shellA.bottom, shellB.bottom),
+            std::min(shellA.right, shellB.right), std::min(shellA.top, shellB.top));
+    }
+    std::stable_sort(overlaps.begin(), overlaps.end(),
+        [](const Overlap& a, const Overlap& b) { return a.area > b.area; });
+
+    // Each shell is named by the first uv of its first edge, eg.
+    // "0.0125 |pCube1|pCubeShape1.map[4] |pCube2|pCubeShape2.map[0] 0.25 0.5 0.3 0.5"
+    // In tile mode the result is prefixed with the tile of the pair
+    MStringArray resultStringArray;
+    std::string result;
+    char number[32];
+    for (const Overlap& overlap : overlaps) {
+        result.clear();
+        if (udimMode) {
+            result += getTileName(overlap.shellA->tileU, overlap.shellA->tileV) + " ";
+        }
+        std::snprintf(number, sizeof(number), "%g", overlap.area);
+        result += number;
+        for (const UVShell* shell : { overlap.shellA, overlap.shellB }) {
+            result += ' ';
+            result += meshPaths[segments.meshId[shell->begin]].asChar();
+            result += ".map[" + std::to_string(segments.uvA[shell->begin]) + "]";
+        }
+        for (float point : overlap.points) {
+            std::snprintf(number, sizeof(number), " %g", static_cast<double>(point));
+            result += number;
+        }
+        resultStringArray.append(MString(result.c_str()));
+    }
+
+    timer.endTimer();
+    if (verbose) {
+        MString numOverlapsStr;
+        numOverlapsStr.set(numOverlaps);
+        MGlobal::displayInfo("Overlapping shell pairs : " + numOverlapsStr);
+        timeIt("Overlap area time : ", timer.elapsedTime());
+    }
+    return resultStringArray;
+}
+
+MStatus FindUvOverlaps::snapshotMesh(unsigned int i, MeshSnapshot& snapshot)
 {
     MStatus status;
 
     MDagPath dagPath;
-    mSel.getDagPath(static_cast<unsigned int>(i), dagPath);
+    mSel.getDagPath(i, dagPath);
 
     // Check if specified object is geometry or not
     status = dagPath.extendToShape();
@@ -257,83 +1289,238 @@ MStatus FindUvOverlaps::init(int i)
 
     MFnMesh fnMesh(dagPath);
 
-    // Send to path vector and get pointer to that
-    const char* dagPathChar = paths.emplace_back(dagPath.fullPathName());
+    // Mesh id of the segments is the index in the selection list
+    meshPaths[i] = dagPath.fullPathName();
 
     MIntArray uvShellIds;
-    unsigned int nbUvShells;
-    fnMesh.getUvShellsIds(uvShellIds, nbUvShells);
+    fnMesh.getUvShellsIds(uvShellIds, snapshot.numShells);
+    snapshot.shellIds.resize(uvShellIds.length());
+    uvShellIds.get(snapshot.shellIds.data());
 
     MIntArray uvCounts; // Num of UVs per face eg. [4, 4, 4, 4, ...]
     MIntArray uvIds;
     fnMesh.getAssignedUVs(uvCounts, uvIds);
+    snapshot.uvCounts.resize(uvCounts.length());
+    uvCounts.get(snapshot.uvCounts.data());
+    snapshot.uvIds.resize(uvIds.length());
+    uvIds.get(snapshot.uvIds.data());
 
-    unsigned int uvCountSize = uvCounts.length(); // is same as number of faces
-    std::vector<std::pair<unsigned int, unsigned int>> idPairs;
-    idPairs.reserve(uvCountSize * 4);
-    unsigned int uvCounter = 0;
-    unsigned int nextCounter;
-    // Loop over each face and its edges, then create a pair of indices
-    for (unsigned int j = 0; j < uvCountSize; j++) {
-        auto numFaceUVs = static_cast<unsigned int>(uvCounts[j]);
-        for (unsigned int localIndex = 0; localIndex < numFaceUVs; localIndex++) {
-            if (localIndex == numFaceUVs - 1) {
-                // Set the nextCounter to the localIndex of zero of the face
-                nextCounter = uvCounter - numFaceUVs + 1;
-            } else {
-                nextCounter = uvCounter + 1;
+    MFloatArray uArray;
+    MFloatArray vArray;
+    fnMesh.getUVs(uArray, vArray);
+    snapshot.u.resize(uArray.length());
+    uArray.get(snapshot.u.data());
+    snapshot.v.resize(vArray.length());
+    vArray.get(snapshot.v.data());
+
+    // Shading group of each face, by id shared with the other meshes
+    if (shadingGroupMode) {
+        MObjectArray shaders;
+        MIntArray faceShaders;
+        fnMesh.getConnectedShaders(dagPath.instanceNumber(), shaders, faceShaders);
+        std::vector<unsigned int> shaderIds(shaders.length());
+        for (unsigned int j = 0; j < shaders.length(); j++) {
+            shaderIds[j] = getShadingGroupId(MFnDependencyNode(shaders[j]).name().asChar());
+        }
+        // Only registered if some face has no shading group
+        bool hasNoShaderId = false;
+        unsigned int noShaderId = 0;
+
+        snapshot.faceShadingGroups.resize(uvCounts.length());
+        for (unsigned int j = 0; j < uvCounts.length(); j++) {
+            int shader = j < faceShaders.length() ? faceShaders[j] : -1;
+            if (shader >= 0 && static_cast<size_t>(shader) < shaderIds.size()) {
+                snapshot.faceShadingGroups[j] = shaderIds[static_cast<size_t>(shader)];
+                continue;
             }
+            if (!hasNoShaderId) {
+                noShaderId = getShadingGroupId("");
+                hasNoShaderId = true;
+            }
+            snapshot.faceShadingGroups[j] = noShaderId;
+        }
+    }
+
+    snapshot.isValid = true;
+    return MS::kSuccess;
+}
 
-            int idA = uvIds[uvCounter];
-            int idB = uvIds[nextCounter];
+void FindUvOverlaps::buildShells(unsigned int meshId, const MeshSnapshot& snapshot, MeshShells& meshShells) const
+{
+    if (!snapshot.isValid) {
+        return;
+    }
 
-            std::pair<unsigned int, unsigned int> idPair;
+    const std::vector<int>& uvShellIds = snapshot.shellIds;
+    const std::vector<int>& uvCounts = snapshot.uvCounts;
+    const std::vector<int>& uvIds = snapshot.uvIds;
+    const std::vector<float>& uArray = snapshot.u;
+    const std::vector<float>& vArray = snapshot.v;
+    unsigned int nbUvShells = snapshot.numShells;
 
-            if (idA < idB)
-                idPair = std::make_pair(idA, idB);
-            else
-                idPair = std::make_pair(idB, idA);
+    auto uvCountSize = static_cast<unsigned int>(uvCounts.size()); // is same as number of faces
+    auto numUVs = static_cast<unsigned int>(uArray.size());
 
-            idPairs.emplace_back(idPair);
+    // Bucket every face edge by its lower uv id, a counting sort which is
+    // linear in the number of face vertices. Each bucket then only holds
+    // the higher ids of the edges starting at that uv
+    std::vector<unsigned int> edgeOffsets(numUVs + 1, 0);
+    unsigned int uvCounter = 0;
+    for (unsigned int j = 0; j < uvCountSize; j++) {
+        auto numFaceUVs = static_cast<unsigned int>(uvCounts[j]);
+        for (unsigned int localIndex = 0; localIndex < numFaceUVs; localIndex++) {
+            // Last edge of the face goes back to its first uv
+            unsigned int nextCounter = localIndex == numFaceUVs - 1 ? uvCounter - localIndex : uvCounter + 1;
+            auto idA = static_cast<unsigned int>(uvIds[uvCounter]);
+            auto idB = static_cast<unsigned int>(uvIds[nextCounter]);
+            edgeOffsets[std::min(idA, idB) + 1]++;
             uvCounter++;
         }
     }
+    for (unsigned int j = 0; j < numUVs; j++) {
+        edgeOffsets[j + 1] += edgeOffsets[j];
+    }
+    std::vector<unsigned int> higherIds(edgeOffsets[numUVs]);
+    uvCounter = 0;
+    for (unsigned int j = 0; j < uvCountSize; j++) {
+        auto numFaceUVs = static_cast<unsigned int>(uvCounts[j]);
+        for (unsigned int localIndex = 0; localIndex < numFaceUVs; localIndex++) {
+            unsigned int nextCounter = localIndex == numFaceUVs - 1 ? uvCounter - localIndex : uvCounter + 1;
+            auto idA = static_cast<unsigned int>(uvIds[uvCounter]);
+            auto idB = static_cast<unsigned int>(uvIds[nextCounter]);
+            higherIds[edgeOffsets[std::min(idA, idB)]++] = std::max(idA, idB);
+            uvCounter++;
+        }
+    }
+    // Filling moved each offset to the begin of the next bucket
+    for (unsigned int j = numUVs; j > 0; j--) {
+        edgeOffsets[j] = edgeOffsets[j - 1];
+    }
+    edgeOffsets[0] = 0;
+
+    // Edges shared by two faces show up twice in their bucket. Drop the
+    // repeats in place, remembering the last bucket each higher id was seen
+    // in, and count the unique edges of every shell on the way
+    std::vector<UVShell>& shells = meshShells.shells;
+    shells.resize(nbUvShells);
+    std::vector<size_t> shellOffsets(nbUvShells + 1, 0);
+    std::vector<unsigned int> numUniqueIds(numUVs, 0);
+    std::vector<unsigned int> lastBucket(numUVs, std::numeric_limits<unsigned int>::max());
+    for (unsigned int idA = 0; idA < numUVs; idA++) {
+        unsigned int bucketBegin = edgeOffsets[idA];
+        unsigned int numUnique = 0;
+        for (unsigned int k = bucketBegin; k < edgeOffsets[idA + 1]; k++) {
+            unsigned int idB = higherIds[k];
+            if (lastBucket[idB] != idA) {
+                lastBucket[idB] = idA;
+                higherIds[bucketBegin + numUnique++] = idB;
+            }
+        }
+        numUniqueIds[idA] = numUnique;
+        if (numUnique != 0) {
+            shellOffsets[static_cast<unsigned int>(uvShellIds[idA]) + 1] += numUnique;
+        }
+    }
 
-    // Remove duplicate elements
-    std::sort(idPairs.begin(), idPairs.end());
-    idPairs.erase(std::unique(idPairs.begin(), idPairs.end()), idPairs.end());
-
-    // Temp countainer for lineSegments for each UVShell
-    std::vector<std::vector<LineSegment>> edgeVector;
-    edgeVector.resize(nbUvShells);
-
-    MFloatArray uArray;
-    MFloatArray vArray;
-    fnMesh.getUVs(uArray, vArray);
-
-    // Setup uv shell objects
-    std::vector<UVShell> shells(nbUvShells);
-
-    // Loop over all id pairs and create lineSegment objects
-    for (auto & idPair : idPairs) {
+    // Edges of each shell are stored next to each other, written straight
+    // into their place in the store
+    for (unsigned int j = 0; j < nbUvShells; j++) {
+        shellOffsets[j + 1] += shellOffsets[j];
+        shells[j].begin = shellOffsets[j];
+        shells[j].end = shellOffsets[j + 1];
+    }
+    SegmentStore& meshSegments = meshShells.segments;
+    meshSegments.resize(shellOffsets[nbUvShells]);
+    for (unsigned int idA = 0; idA < numUVs; idA++) {
+        if (numUniqueIds[idA] == 0) {
+            continue;
+        }
+        size_t& shellOffset = shellOffsets[static_cast<unsigned int>(uvShellIds[idA])];
+        for (unsigned int k = edgeOffsets[idA]; k < edgeOffsets[idA] + numUniqueIds[idA]; k++) {
+            unsigned int idB = higherIds[k];
+            meshSegments.set(shellOffset++,
+                uArray[idA], vArray[idA], static_cast<int>(idA),
+                uArray[idB], vArray[idB], static_cast<int>(idB),
+                meshId);
+        }
+    }
 
-        unsigned int idA = idPair.first;
-        unsigned int idB = idPair.second;
-        Point2D p1(uArray[idA], vArray[idA], static_cast<int>(idA));
-        Point2D p2(uArray[idB], vArray[idB], static_cast<int>(idB));
+    // Triangulate every face and sort the triangles by shell like the edges.
+    // A face of n uvs gives at most n - 2 triangles, all inside of it, so the
+    // biggest triangle of each shell gives a point which is inside the shell
+    // for sure
+    std::vector<size_t> triangleOffsets(nbUvShells + 1, 0);
+    uvCounter = 0;
+    for (unsigned int j = 0; j < uvCountSize; j++) {
+        auto numFaceUVs = static_cast<unsigned int>(uvCounts[j]);
+        if (numFaceUVs >= 3) {
+            auto shellIndex = static_cast<unsigned int>(uvShellIds[static_cast<unsigned int>(uvIds[uvCounter])]);
+            triangleOffsets[shellIndex + 1] += numFaceUVs - 2;
+        }
+        uvCounter += numFaceUVs;
+    }
+    for (unsigned int j = 0; j < nbUvShells; j++) {
+        triangleOffsets[j + 1] += triangleOffsets[j];
+        shells[j].triangleBegin = triangleOffsets[j];
+        shells[j].triangleEnd = triangleOffsets[j];
+    }
 
-        // Create new lineSegment object
-        LineSegment line(p1, p2, dagPathChar);
+    std::vector<TriangleBVH::Triangle>& meshTriangles = meshShells.triangles;
+    meshTriangles.resize(triangleOffsets[nbUvShells]);
+    std::vector<float> biggestAreas(nbUvShells, 0.0F);
+    PolygonTriangulator triangulator;
+    uvCounter = 0;
+    for (unsigned int j = 0; j < uvCountSize; j++) {
+        auto numFaceUVs = static_cast<unsigned int>(uvCounts[j]);
+        if (numFaceUVs >= 3) {
+            auto shellIndex = static_cast<unsigned int>(uvShellIds[static_cast<unsigned int>(uvIds[uvCounter])]);
+            UVShell& shell = shells[shellIndex];
+            triangulator.triangulate(uArray.data(), vArray.data(), &uvIds[uvCounter], numFaceUVs);
+            for (const TriangleBVH::Triangle& triangle : triangulator.triangles) {
+                meshTriangles[shell.triangleEnd++] = triangle;
+                float area = std::fabs((triangle.x1 - triangle.x0) * (triangle.y2 - triangle.y0)
+                    - (triangle.y1 - triangle.y0) * (triangle.x2 - triangle.x0));
+                if (area > biggestAreas[shellIndex]) {
+                    biggestAreas[shellIndex] = area;
+                    shell.insideU = (triangle.x0 + triangle.x1 + triangle.x2) / 3.0F;
+                    shell.insideV = (triangle.y0 + triangle.y1 + triangle.y2) / 3.0F;
+                }
+            }
+        }
+        uvCounter += numFaceUVs;
+    }
 
-        auto shellIndex = static_cast<unsigned int>(uvShellIds[idA]);
-        shells[shellIndex].lines.emplace_back(line);
+    // Shading groups of each shell's faces
+    if (shadingGroupMode) {
+        uvCounter = 0;
+        for (unsigned int j = 0; j < uvCountSize; j++) {
+            auto numFaceUVs = static_cast<unsigned int>(uvCounts[j]);
+            if (numFaceUVs != 0) {
+                auto shellIndex = static_cast<unsigned int>(uvShellIds[static_cast<unsigned int>(uvIds[uvCounter])]);
+                unsigned int shaderId = snapshot.faceShadingGroups[j];
+                std::vector<unsigned int>& shellShaders = shells[shellIndex].shadingGroups;
+                if (shellShaders.empty() || shellShaders.back() != shaderId) {
+                    shellShaders.push_back(shaderId);
+                }
+            }
+            uvCounter += numFaceUVs;
+        }
+        for (auto& shell : shells) {
+            std::sort(shell.shadingGroups.begin(), shell.shadingGroups.end());
+            shell.shadingGroups.erase(std::unique(shell.shadingGroups.begin(), shell.shadingGroups.end()), shell.shadingGroups.end());
+        }
     }
 
-    for (auto & shell : shells) {
-        pushToShellVector(shell);
+    if (udimMode) {
+        SegmentStore tileSegments;
+        splitShellsAtTileBorders(meshSegments, shells, tileSegments);
+        meshSegments = std::move(tileSegments);
     }
 
-    return MS::kSuccess;
+    // Shells without any edge can't overlap
+    shells.erase(std::remove_if(shells.begin(), shells.end(),
+                     [](const UVShell& shell) { return shell.begin == shell.end; }),
+        shells.end());
 }
 
 void FindUvOverlaps::timeIt(const std::string& text, double t)
@@ -382,11 +1569,3 @@ MStatus uninitializePlugin(MObject obj)
 
     return status;
 }
-
-const char *MStringVector::emplace_back(const MString& path) {
-    std::lock_guard<std::mutex> lock(mtx);
-    elements.emplace_back(path);
-    MString &tempMstring = elements.back();
-    const char* tempChar = tempMstring.asChar();
-    return tempChar;
-}
@@ -2,31 +2,80 @@
 
 
 #include "bentleyOttmann/bentleyOttmann.hpp"
-#include "bentleyOttmann/lineSegment.hpp"
+#include "bentleyOttmann/bruteForce.hpp"
+#include "bentleyOttmann/overlapArea.hpp"
+#include "bentleyOttmann/segmentStore.hpp"
+#include "bentleyOttmann/triangleBvh.hpp"
+#include "bentleyOttmann/uniformGrid.hpp"
+#include "overlapCache.hpp"
+#include <utility>
 #include <vector>
 #include <thread>
-#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_map>
 #include <maya/MString.h>
+#include <maya/MStringArray.h>
 #include <maya/MArgList.h>
 #include <maya/MSyntax.h>
 #include <maya/MPxCommand.h>
 #include <maya/MSelectionList.h>
 
 class UVShell {
-    float left, right, top, bottom;
 public:
-    std::vector<LineSegment> lines;
-    void initAABB();
+    // Bounding box, set by initAABB
+    float left, right, top, bottom;
+    // Range of the shell's edges in the segment store
+    size_t begin, end;
+    // Range of the shell's face triangles, and a point inside the biggest one
+    // which tells whether the shell lies inside another shell
+    size_t triangleBegin, triangleEnd;
+    float insideU, insideV;
+    // Tile of the shell when shells are split at UDIM tile borders
+    int tileU, tileV;
+    // Sorted ids of the shading groups assigned to the shell's faces, only
+    // filled when checks are scoped by shading group
+    std::vector<unsigned int> shadingGroups;
+    void initAABB(const SegmentStore& store);
     bool operator*(const UVShell& other) const;
-    UVShell operator&&(const UVShell& other) const;
 };
 
-class MStringVector {
-private:
-    std::mutex mtx;
-    std::vector<MString> elements;
-public:
-    const char* emplace_back(const MString& path);
+typedef std::pair<const UVShell*, const UVShell*> UVShellPair;
+
+// One task of the check phase, a shell on its own (shellB is null) or a pair
+// of overlapping shells. Big shells are split into several checks, each one
+// reporting the crossings of a slab [slabLeft, slabRight) along u
+struct UVCheck {
+    const UVShell* shellA;
+    const UVShell* shellB;
+    float slabLeft;
+    float slabRight;
+    size_t numEdges;
+    // Index of the shell or of the shell pair the check comes from
+    size_t source;
+};
+
+// Copy of what the checks need from a mesh, taken on the main thread so that
+// building edges and shells from it needs no Maya call
+struct MeshSnapshot {
+    bool isValid{};
+    unsigned int numShells{};
+    // Shell of each uv
+    std::vector<int> shellIds;
+    // Number of uvs of each face, and the uvs of all faces one after another
+    std::vector<int> uvCounts;
+    std::vector<int> uvIds;
+    std::vector<float> u, v;
+    // Shading group id of each face, only filled in shading group mode
+    std::vector<unsigned int> faceShadingGroups;
+};
+
+// Edges, triangles and shells of one mesh, indexed from zero until they are
+// gathered into the stores of the command
+struct MeshShells {
+    SegmentStore segments;
+    std::vector<TriangleBVH::Triangle> triangles;
+    std::vector<UVShell> shells;
 };
 
 class FindUvOverlaps : public MPxCommand {
@@ -40,18 +89,73 @@ public:
     static MSyntax newSyntax();
 
 private:
-	std::mutex locker;
     MString uvSet;
+    // Overlap engine, "sweep" for BentleyOttmann on shells or "grid" for a
+    // uniform grid over all edges
+    MString engine;
     bool verbose;
+    // Only tell whether each mesh has any overlap, checks stop at the first
+    // crossing and checks of meshes already known to overlap are skipped
+    bool anyMode;
+    // Cut edges at UDIM tile borders and only look for overlaps within each
+    // tile. Results are prefixed with their tile
+    bool udimMode;
+    // Only check pairs of shells sharing a shading group, as overlaps
+    // between different materials don't end up on the same texture
+    bool shadingGroupMode;
+    // Id of each shading group name, shared by all meshes. Faces without
+    // any shading group get the id of the empty name
+    std::unordered_map<std::string, unsigned int> shadingGroupIds;
+    // Reuse the results of earlier runs for shells and shell pairs which
+    // didn't change since. Only the sweep engine uses it, not in any mode
+    bool cacheMode;
+    // Return the area and crossing points of each pair of overlapping
+    // shells instead of uvs, largest overlap first
+    bool areaMode;
+    unsigned int numThreads;
+    // Shells and shell pairs with fewer edges than this are checked pair by
+    // pair instead of with the sweep
+    unsigned int bruteForceThreshold;
     MSelectionList mSel;
-    MStringVector paths;
+    // Full path of each mesh, indexed by the mesh id of the segment store
+    std::vector<MString> meshPaths;
 
-    std::vector<std::vector<LineSegment> > finalResult;
+    SegmentStore segments;
+    std::vector<std::vector<unsigned int> > finalResult;
+    // Meshes found to overlap so far in any mode, indexed by mesh id
+    std::vector<std::atomic<bool> > meshOverlaps;
     std::vector<UVShell> shellVector;
+    // Face triangles of all shells, and shells found lying inside another
+    // shell without any edge crossing
+    std::vector<TriangleBVH::Triangle> triangles;
+    std::vector<const UVShell*> containedShells;
+    std::vector<UVShellPair> shellPairs;
+    // Inner and outer shell of each containment found, area mode only
+    std::vector<UVShellPair> containedPairs;
+
+    // Cache mode only. Hash of each shell of shellVector, and the pairs of
+    // shellPairs whose results came from the cache
+    std::vector<uint64_t> shellHashes;
+    std::vector<unsigned char> isPairCached;
+    // Cached overlapping uvs of shells
+    std::vector<std::pair<const UVShell*, const std::vector<uint32_t>*> > cachedResults;
+    // Overlapping uvs of both shells of each checked pair, first and second
+    // shell at 2 * pair and 2 * pair + 1, cached once containment is known
+    std::vector<std::vector<uint32_t> > pairUvs;
 
-    MStatus init(int i);
-    void btoCheck(UVShell &shell);
-    void pushToLineVector(std::vector<LineSegment> &v);
-    void pushToShellVector(UVShell &shell);
+    MStatus snapshotMesh(unsigned int i, MeshSnapshot& snapshot);
+    void buildShells(unsigned int meshId, const MeshSnapshot& snapshot, MeshShells& meshShells) const;
+    void gatherShells(const MeshShells& meshShells);
+    void checkShells();
+    void checkGrid();
+    void checkContainment();
+    void updateCache();
+    MStringArray getOverlapAreas() const;
+    size_t findShellPairs(std::vector<UVShellPair>& pairs) const;
+    size_t getShellIndex(size_t edge) const;
+    unsigned int getShadingGroupId(const std::string& name);
+    void btoCheck(const UVCheck& check, std::vector<unsigned int>& result);
+    bool isResolved(const UVCheck& check) const;
+    void setMeshOverlaps(const std::vector<unsigned int>& result, size_t begin);
     static void timeIt(const std::string& text, double t);
 };
@@ -0,0 +1,142 @@
+#include "overlapCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Runs an entry stays cached without being used
+const unsigned int maxUnusedRuns = 4;
+
+uint64_t mix(uint64_t hash, uint64_t value)
+{
+    // splitmix64 finalizer over the running hash
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+uint64_t mix(uint64_t hash, float a, float b)
+{
+    uint32_t bitsA, bitsB;
+    std::memcpy(&bitsA, &a, sizeof(bitsA));
+    std::memcpy(&bitsB, &b, sizeof(bitsB));
+    return mix(hash, (static_cast<uint64_t>(bitsA) << 32) | bitsB);
+}
+
+void sortUnique(std::vector<uint32_t>& uvs)
+{
+    std::sort(uvs.begin(), uvs.end());
+    uvs.erase(std::unique(uvs.begin(), uvs.end()), uvs.end());
+}
+
+} // namespace
+
+OverlapCache& OverlapCache::get()
+{
+    static OverlapCache cache;
+    return cache;
+}
+
+uint64_t OverlapCache::hashShell(const SegmentStore& segments, size_t begin, size_t end,
+    const std::vector<TriangleBVH::Triangle>& triangles, size_t triangleBegin, size_t triangleEnd)
+{
+    uint64_t hash = mix(end - begin, triangleEnd - triangleBegin);
+    for (size_t i = begin; i < end; i++) {
+        hash = mix(hash, segments.x0[i], segments.y0[i]);
+        hash = mix(hash, segments.x1[i], segments.y1[i]);
+        hash = mix(hash, (static_cast<uint64_t>(static_cast<uint32_t>(segments.uvA[i])) << 32)
+                | static_cast<uint32_t>(segments.uvB[i]));
+    }
+    for (size_t i = triangleBegin; i < triangleEnd; i++) {
+        const TriangleBVH::Triangle& triangle = triangles[i];
+        hash = mix(hash, triangle.x0, triangle.y0);
+        hash = mix(hash, triangle.x1, triangle.y1);
+        hash = mix(hash, triangle.x2, triangle.y2);
+    }
+    return hash;
+}
+
+uint64_t OverlapCache::getPairKey(uint64_t hashA, uint64_t hashB)
+{
+    if (hashA > hashB) {
+        std::swap(hashA, hashB);
+    }
+    return mix(hashA, hashB);
+}
+
+const std::vector<uint32_t>* OverlapCache::findShell(uint64_t hash)
+{
+    auto it = shells.find(hash);
+    if (it == shells.end()) {
+        return nullptr;
+    }
+    it->second.lastRun = run;
+    return &it->second.uvs;
+}
+
+void OverlapCache::addShell(uint64_t hash, std::vector<uint32_t> uvs)
+{
+    sortUnique(uvs);
+    ShellEntry& entry = shells[hash];
+    entry.uvs.swap(uvs);
+    entry.lastRun = run;
+}
+
+bool OverlapCache::findPair(uint64_t hashA, uint64_t hashB, const std::vector<uint32_t>*& uvsA, const std::vector<uint32_t>*& uvsB)
+{
+    auto it = pairs.find(getPairKey(hashA, hashB));
+    if (it == pairs.end()) {
+        return false;
+    }
+    it->second.lastRun = run;
+    uvsA = &it->second.uvsFirst;
+    uvsB = &it->second.uvsSecond;
+    if (hashA > hashB) {
+        std::swap(uvsA, uvsB);
+    }
+    return true;
+}
+
+void OverlapCache::addPair(uint64_t hashA, uint64_t hashB, std::vector<uint32_t> uvsA, std::vector<uint32_t> uvsB)
+{
+    sortUnique(uvsA);
+    sortUnique(uvsB);
+    if (hashA > hashB) {
+        uvsA.swap(uvsB);
+    }
+    PairEntry& entry = pairs[getPairKey(hashA, hashB)];
+    entry.uvsFirst.swap(uvsA);
+    entry.uvsSecond.swap(uvsB);
+    entry.lastRun = run;
+}
+
+void OverlapCache::endRun()
+{
+    for (auto it = shells.begin(); it != shells.end();) {
+        if (run - it->second.lastRun >= maxUnusedRuns) {
+            it = shells.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = pairs.begin(); it != pairs.end();) {
+        if (run - it->second.lastRun >= maxUnusedRuns) {
+            it = pairs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    run++;
+}
+
+void OverlapCache::clear()
+{
+    shells.clear();
+    pairs.clear();
+}
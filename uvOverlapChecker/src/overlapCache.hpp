@@ -0,0 +1,67 @@
+#pragma once
+
+#include "bentleyOttmann/segmentStore.hpp"
+#include "bentleyOttmann/triangleBvh.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Results of earlier runs, kept for as long as the plugin is loaded. Shells
+// are identified by a hash of their edges and faces, so a shell which didn't
+// change since the last run is recognized whatever its mesh or position in
+// the selection is. Results are the overlapping uv indices of each shell,
+// within the shell's own mesh
+class OverlapCache {
+public:
+    // The cache shared by all runs of the command
+    static OverlapCache& get();
+
+    // Hash of edges [begin, end) and triangles [triangleBegin, triangleEnd)
+    static uint64_t hashShell(const SegmentStore& segments, size_t begin, size_t end,
+        const std::vector<TriangleBVH::Triangle>& triangles, size_t triangleBegin, size_t triangleEnd);
+
+    // Uvs of a shell overlapping its own edges, null if not cached
+    const std::vector<uint32_t>* findShell(uint64_t hash);
+    void addShell(uint64_t hash, std::vector<uint32_t> uvs);
+
+    // Uvs of each shell of a pair overlapping the other one. Returns false
+    // if the pair is not cached
+    bool findPair(uint64_t hashA, uint64_t hashB, const std::vector<uint32_t>*& uvsA, const std::vector<uint32_t>*& uvsB);
+    void addPair(uint64_t hashA, uint64_t hashB, std::vector<uint32_t> uvsA, std::vector<uint32_t> uvsB);
+
+    // Call once at the end of each run. Forgets what was not used during the
+    // last few runs, so that the cache doesn't grow with every edit
+    void endRun();
+
+    void clear();
+
+    size_t getNumShells() const
+    {
+        return shells.size();
+    }
+
+    size_t getNumPairs() const
+    {
+        return pairs.size();
+    }
+
+private:
+    struct ShellEntry {
+        std::vector<uint32_t> uvs;
+        unsigned int lastRun;
+    };
+
+    // Uvs of the shell with the smaller hash come first
+    struct PairEntry {
+        std::vector<uint32_t> uvsFirst;
+        std::vector<uint32_t> uvsSecond;
+        unsigned int lastRun;
+    };
+
+    std::unordered_map<uint64_t, ShellEntry> shells;
+    std::unordered_map<uint64_t, PairEntry> pairs;
+    unsigned int run{};
+
+    static uint64_t getPairKey(uint64_t hashA, uint64_t hashB);
+};